@@ -0,0 +1,587 @@
+// Сквозной бенчмарк SearchServer.
+//
+// Сборка (из каталога search-server/benchmark):
+//   g++ --std=c++17 -O2 -pthread main.cpp $(ls ../*.cpp | grep -v main.cpp) -o build/main -ltbb
+//
+// Пример запуска и сравнения с сохранённым baseline:
+//   ./build/main --documents=50000 --threads=8 > baseline.tsv
+//   ./build/main --documents=50000 --threads=8 --baseline=baseline.tsv
+//
+// Выигрыш от перенумерации документов — тот же запуск с --reorder=1 против baseline без неё,
+// на документах с темами (--topics), иначе перенумеровывать нечего
+
+#include "../search_server.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+#include "../document_reordering.h"
+#include "../sharded_search_server.h"
+#include "../test_example_functions.h"
+#include "../benchmark_stats.h"
+#include <tbb/global_control.h>
+#include <algorithm>
+#include <execution>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct BenchmarkOptions
+{
+    int documents = 10'000;
+    int dictionary = 1'000;
+    int max_word_length = 10;
+    int document_words = 70;
+    int queries = 1'000;
+    int query_words = 10;
+    double minus_prob = 0.1;
+    int threads = 0;
+    int match_samples = 1'000;
+    int match_all_queries = 100;
+    // Рейтинги документов равномерно в [-rating_spread, rating_spread], при 0 у всех рейтинг 2
+    int rating_spread = 0;
+    int remove_count = 1'000;
+    double duplicate_fraction = 0.1;
+    // Копий одного документа в корпусе дубликатов: кластер крупнее корзины LSH (max_bucket_size)
+    int spam_cluster = 1'500;
+    unsigned seed = mt19937::default_seed;
+    string analyzer = "none"s;
+    int stop_words = 1;
+    // Точность заранее посчитанных весов: none, double, uint16 или uint8
+    string impacts = "none"s;
+    // Перенумеровать документы по рейтингу (OrderByStaticRank) перед поиском
+    bool static_rank = false;
+    // Документы из topics тем: 80% слов документа берутся из словаря его темы. При 0 слова равновероятны
+    int topics = 0;
+    // Перенумеровать документы бисекцией графа (ReorderDocuments) перед поиском
+    bool reorder = false;
+    // Дополнительно построить ShardedSearchServer из стольких шардов и сравнить поиск; 0 — не строить
+    int shards = 0;
+    // Бюджет запроса find_top.budget в записях posting-листов
+    int budget_postings = 10'000;
+    string baseline;
+};
+
+BenchmarkOptions ParseOptions(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg = argv[i];
+        const auto eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos)
+        {
+            throw invalid_argument("Expected --name=value, got "s + string(arg));
+        }
+        const string_view name = arg.substr(2, eq - 2);
+        const string value(arg.substr(eq + 1));
+        if (name == "documents"sv)
+        {
+            options.documents = stoi(value);
+        }
+        else if (name == "dictionary"sv)
+        {
+            options.dictionary = stoi(value);
+        }
+        else if (name == "max-word-length"sv)
+        {
+            options.max_word_length = stoi(value);
+        }
+        else if (name == "document-words"sv)
+        {
+            options.document_words = stoi(value);
+        }
+        else if (name == "queries"sv)
+        {
+            options.queries = stoi(value);
+        }
+        else if (name == "query-words"sv)
+        {
+            options.query_words = stoi(value);
+        }
+        else if (name == "minus-prob"sv)
+        {
+            options.minus_prob = stod(value);
+        }
+        else if (name == "threads"sv)
+        {
+            options.threads = stoi(value);
+        }
+        else if (name == "match-samples"sv)
+        {
+            options.match_samples = stoi(value);
+        }
+        else if (name == "rating-spread"sv)
+        {
+            options.rating_spread = stoi(value);
+        }
+        else if (name == "match-all-queries"sv)
+        {
+            options.match_all_queries = stoi(value);
+        }
+        else if (name == "remove-count"sv)
+        {
+            options.remove_count = stoi(value);
+        }
+        else if (name == "duplicate-fraction"sv)
+        {
+            options.duplicate_fraction = stod(value);
+        }
+        else if (name == "spam-cluster"sv)
+        {
+            options.spam_cluster = stoi(value);
+        }
+        else if (name == "budget-postings"sv)
+        {
+            options.budget_postings = stoi(value);
+        }
+        else if (name == "seed"sv)
+        {
+            options.seed = static_cast<unsigned>(stoul(value));
+        }
+        else if (name == "stop-words"sv)
+        {
+            options.stop_words = stoi(value);
+        }
+        else if (name == "impacts"sv)
+        {
+            if (value != "none"s && value != "double"s && value != "uint16"s && value != "uint8"s)
+            {
+                throw invalid_argument("Impacts must be none, double, uint16 or uint8"s);
+            }
+            options.impacts = value;
+        }
+        else if (name == "static-rank"sv)
+        {
+            options.static_rank = stoi(value) != 0;
+        }
+        else if (name == "topics"sv)
+        {
+            options.topics = stoi(value);
+        }
+        else if (name == "reorder"sv)
+        {
+            options.reorder = stoi(value) != 0;
+        }
+        else if (name == "shards"sv)
+        {
+            options.shards = stoi(value);
+        }
+        else if (name == "analyzer"sv)
+        {
+            if (value != "none"s && value != "fold"s && value != "strip"s)
+            {
+                throw invalid_argument("Analyzer must be none, fold or strip"s);
+            }
+            options.analyzer = value;
+        }
+        else if (name == "baseline"sv)
+        {
+            options.baseline = value;
+        }
+        else
+        {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    return options;
+}
+
+// Тема документа выбирается случайно, тема t — слова словаря с номерами, равными t по модулю topics
+vector<string> GenerateTopicDocuments(mt19937 &generator, const vector<string> &dictionary, int document_count, int word_count, int topics)
+{
+    const int topic_size = max<int>(dictionary.size() / topics, 1);
+    vector<string> documents;
+    documents.reserve(document_count);
+    for (int i = 0; i < document_count; ++i)
+    {
+        const int topic = uniform_int_distribution<int>(0, topics - 1)(generator);
+        string document;
+        for (int j = 0; j < word_count; ++j)
+        {
+            if (!document.empty())
+            {
+                document.push_back(' ');
+            }
+            const size_t index = uniform_real_distribution<>(0, 1)(generator) < 0.8
+                                     ? (topic + static_cast<size_t>(topics) * uniform_int_distribution<int>(0, topic_size - 1)(generator)) % dictionary.size()
+                                     : uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator);
+            document += dictionary[index];
+        }
+        documents.push_back(move(document));
+    }
+    return documents;
+}
+
+// find(query) возвращает выдачу по запросу
+template <typename FindTop>
+void BenchmarkFindTop(BenchmarkReport &report, string_view name, const vector<string> &queries, FindTop find)
+{
+    vector<double> samples;
+    samples.reserve(queries.size());
+    double total_relevance = 0;
+    for (const string &query : queries)
+    {
+        samples.push_back(MeasureMicroseconds([&]
+                                              {
+                                                  for (const Document &document : find(query))
+                                                  {
+                                                      total_relevance += document.relevance;
+                                                  } }));
+    }
+    report.AddLatency(name, Summarize(move(samples)));
+    // Контрольная сумма позволяет убедиться, что оптимизация не поменяла выдачу
+    report.Add(string(name) + ".checksum"s, total_relevance, "relevance");
+}
+
+template <typename ExecutionPolicy>
+void BenchmarkMatch(BenchmarkReport &report, string_view name, const SearchServer &search_server, const vector<string> &queries, const vector<int> &document_ids, ExecutionPolicy &&policy)
+{
+    vector<double> samples;
+    samples.reserve(document_ids.size());
+    size_t matched_words = 0;
+    for (size_t i = 0; i < document_ids.size(); ++i)
+    {
+        const string &query = queries[i % queries.size()];
+        samples.push_back(MeasureMicroseconds([&]
+                                              {
+                                                  const auto [words, status] = search_server.MatchDocument(policy, query, document_ids[i]);
+                                                  matched_words += words.size(); }));
+    }
+    report.AddLatency(name, Summarize(move(samples)));
+    report.Add(string(name) + ".checksum"s, matched_words, "words");
+}
+
+// Сопоставление каждого запроса со всей коллекцией
+template <typename ExecutionPolicy>
+void BenchmarkMatchAll(BenchmarkReport &report, string_view name, const SearchServer &search_server, const vector<string> &queries, size_t query_count, ExecutionPolicy &&policy)
+{
+    vector<double> samples;
+    samples.reserve(query_count);
+    size_t matched_words = 0;
+    for (size_t i = 0; i < query_count; ++i)
+    {
+        samples.push_back(MeasureMicroseconds([&]
+                                              {
+                                                  for (const MatchedDocument &row : search_server.MatchAllDocuments(policy, queries[i % queries.size()], [](int, DocumentStatus, int) { return true; }))
+                                                  {
+                                                      matched_words += row.words.size();
+                                                  } }));
+    }
+    report.AddLatency(name, Summarize(move(samples)));
+    report.Add(string(name) + ".checksum"s, matched_words, "words");
+}
+
+template <typename ExecutionPolicy>
+void BenchmarkRemove(BenchmarkReport &report, string_view name, SearchServer &search_server, const vector<int> &document_ids, ExecutionPolicy &&policy)
+{
+    vector<double> samples;
+    samples.reserve(document_ids.size());
+    for (const int document_id : document_ids)
+    {
+        samples.push_back(MeasureMicroseconds([&]
+                                              { search_server.RemoveDocument(policy, document_id); }));
+    }
+    report.AddLatency(name, Summarize(move(samples)));
+}
+
+void ReportExecutionStats(BenchmarkReport &report, string_view name, const ExecutionStats &stats)
+{
+    const uint64_t calls = stats.sequential + stats.parallel;
+    report.Add(string(name) + ".parallel_share"s, calls == 0 ? 0.0 : stats.parallel * 1.0 / calls, "ratio");
+    report.Add(string(name) + ".average_threads"s, stats.parallel == 0 ? 1.0 : stats.parallel_threads * 1.0 / stats.parallel, "threads");
+    report.Add(string(name) + ".average_work"s, calls == 0 ? 0.0 : stats.estimated_work * 1.0 / calls, "postings");
+}
+
+// Стоп-слова — первые слова словаря
+vector<string> GetStopWords(const vector<string> &dictionary, const BenchmarkOptions &options)
+{
+    return vector<string>(dictionary.begin(), dictionary.begin() + min<size_t>(options.stop_words, dictionary.size()));
+}
+
+// Рейтинг выводится из номера документа, чтобы не сдвигать генератор текстов
+int GetDocumentRating(size_t document_index, const BenchmarkOptions &options)
+{
+    return options.rating_spread == 0 ? 2 : static_cast<int>(MixKey(document_index ^ options.seed) % (2 * options.rating_spread + 1)) - options.rating_spread;
+}
+
+unique_ptr<SearchServer> BuildServer(const vector<string> &dictionary, const vector<string> &documents, const BenchmarkOptions &options)
+{
+    const vector<string> stop_words = GetStopWords(dictionary, options);
+    const string &analyzer = options.analyzer;
+    unique_ptr<SearchServer> search_server;
+    if (analyzer == "none"s)
+    {
+        search_server = make_unique<SearchServer>(stop_words);
+    }
+    else
+    {
+        TextAnalyzer::Options analyzer_options;
+        analyzer_options.strip_punctuation = analyzer == "strip"s;
+        search_server = make_unique<SearchServer>(stop_words, TextAnalyzer(analyzer_options));
+    }
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        search_server->AddDocument(i, documents[i], DocumentStatus::ACTUAL, {GetDocumentRating(i, options)});
+    }
+    return search_server;
+}
+
+// Без анализатора: ShardedSearchServer его не поддерживает
+unique_ptr<ShardedSearchServer> BuildShardedServer(const vector<string> &dictionary, const vector<string> &documents, const BenchmarkOptions &options)
+{
+    auto sharded_server = make_unique<ShardedSearchServer>(GetStopWords(dictionary, options), options.shards);
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        sharded_server->AddDocument(i, documents[i], DocumentStatus::ACTUAL, {GetDocumentRating(i, options)});
+    }
+    return sharded_server;
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    try
+    {
+        options = ParseOptions(argc, argv);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    unique_ptr<tbb::global_control> thread_limit;
+    if (options.threads > 0)
+    {
+        thread_limit = make_unique<tbb::global_control>(tbb::global_control::max_allowed_parallelism, options.threads);
+    }
+
+    BenchmarkReport report;
+    report.AddParameter("documents"sv, to_string(options.documents));
+    report.AddParameter("dictionary"sv, to_string(options.dictionary));
+    report.AddParameter("max_word_length"sv, to_string(options.max_word_length));
+    report.AddParameter("document_words"sv, to_string(options.document_words));
+    report.AddParameter("queries"sv, to_string(options.queries));
+    report.AddParameter("query_words"sv, to_string(options.query_words));
+    report.AddParameter("minus_prob"sv, to_string(options.minus_prob));
+    report.AddParameter("threads"sv, to_string(tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism)));
+    report.AddParameter("seed"sv, to_string(options.seed));
+    report.AddParameter("analyzer"sv, options.analyzer);
+    report.AddParameter("impacts"sv, options.impacts);
+    report.AddParameter("rating_spread"sv, to_string(options.rating_spread));
+    report.AddParameter("static_rank"sv, to_string(options.static_rank));
+    report.AddParameter("topics"sv, to_string(options.topics));
+    report.AddParameter("reorder"sv, to_string(options.reorder));
+    report.AddParameter("shards"sv, to_string(options.shards));
+    report.AddParameter("spam_cluster"sv, to_string(options.spam_cluster));
+    report.AddParameter("budget_postings"sv, to_string(options.budget_postings));
+    if (!options.baseline.empty() && !report.LoadBaseline(options.baseline))
+    {
+        cerr << "Cannot read baseline "s << options.baseline << endl;
+        return 1;
+    }
+
+    mt19937 generator(options.seed);
+    const auto dictionary = GenerateDictionary(generator, options.dictionary, options.max_word_length);
+    const auto documents = options.topics > 0 ? GenerateTopicDocuments(generator, dictionary, options.documents, options.document_words, options.topics)
+                                              : GenerateQueries(generator, dictionary, options.documents, options.document_words);
+    const auto queries = GenerateQueries(generator, dictionary, options.queries, options.query_words, options.minus_prob);
+
+    const size_t memory_before = GetResidentMemoryBytes();
+    unique_ptr<SearchServer> search_server;
+    const double build_us = MeasureMicroseconds([&]
+                                                { search_server = BuildServer(dictionary, documents, options); });
+    const size_t memory_after = GetResidentMemoryBytes();
+    report.Add("build.seconds"sv, build_us / 1e6, "s");
+    report.Add("build.throughput"sv, documents.size() / (build_us / 1e6), "docs/s");
+    report.Add("build.memory"sv, memory_after > memory_before ? memory_after - memory_before : 0, "bytes");
+    report.Add("build.memory_per_document"sv, documents.empty() || memory_after <= memory_before ? 0.0 : (memory_after - memory_before) * 1.0 / documents.size(), "bytes");
+
+    if (options.reorder)
+    {
+        report.Add("reorder.seconds"sv, MeasureMicroseconds([&]
+                                                           { search_server->ReorderDocuments(ComputeBisectionOrder(*search_server)); }) /
+                                             1e6,
+                   "s");
+    }
+    {
+        const PostingGapStats gaps = MeasurePostingGaps(*search_server, search_server->GetDocumentOrder());
+        report.Add("postings.varint_bytes"sv, gaps.varint_bytes, "bytes");
+        report.Add("postings.average_log_gap"sv, gaps.average_log_gap, "bits");
+    }
+
+    if (options.impacts != "none"s)
+    {
+        const ImpactPrecision precision = options.impacts == "double"s   ? ImpactPrecision::DOUBLE
+                                          : options.impacts == "uint16"s ? ImpactPrecision::UINT16
+                                                                         : ImpactPrecision::UINT8;
+        report.Add("precompute_impacts.seconds"sv, MeasureMicroseconds([&]
+                                                                     { search_server->PrecomputeImpacts(precision); }) /
+                                                       1e6,
+                   "s");
+    }
+
+    if (options.static_rank)
+    {
+        report.Add("static_rank.seconds"sv, MeasureMicroseconds([&]
+                                                               { search_server->OrderByStaticRank(); }) /
+                                                 1e6,
+                   "s");
+    }
+
+    BenchmarkFindTop(report, "find_top.seq"sv, queries, [&](const string &query)
+                     { return search_server->FindTopDocuments(execution::seq, query); });
+    BenchmarkFindTop(report, "find_top.par"sv, queries, [&](const string &query)
+                     { return search_server->FindTopDocuments(execution::par, query); });
+    // Выбор seq или par по запросу; доля параллельных запросов — в execution.find_top.parallel_share
+    search_server->ResetExecutionStats();
+    BenchmarkFindTop(report, "find_top.auto"sv, queries, [&](const string &query)
+                     { return search_server->FindTopDocuments(search_execution::automatic, query); });
+    ReportExecutionStats(report, "execution.find_top"sv, search_server->GetExecutionStats());
+    {
+        // Некорректные запросы (слово с двумя минусами в конце): код ошибки против исключения
+        vector<string> invalid_queries(queries.size());
+        transform(queries.begin(), queries.end(), invalid_queries.begin(), [](const string &query)
+                  { return query + " --invalid"s; });
+        BenchmarkFindTop(report, "find_top.invalid.try"sv, invalid_queries, [&](const string &query)
+                         { return search_server->TryFindTopDocuments(query).value; });
+        BenchmarkFindTop(report, "find_top.invalid.throw"sv, invalid_queries, [&](const string &query)
+                         {
+                             try
+                             {
+                                 return search_server->FindTopDocuments(query);
+                             }
+                             catch (const invalid_argument &)
+                             {
+                                 return vector<Document>{};
+                             } });
+    }
+    {
+        // Частые слова запроса сверх бюджета пропускаются; доля неполных выдач — find_top.budget.partial_share
+        SearchBudget budget;
+        budget.max_postings = options.budget_postings;
+        size_t partial_count = 0;
+        size_t postings_scored = 0;
+        BenchmarkFindTop(report, "find_top.budget.seq"sv, queries, [&](const string &query)
+                         {
+                             BudgetedSearchResult result = search_server->FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, budget);
+                             partial_count += result.partial;
+                             postings_scored += result.postings_scored;
+                             return move(result.documents); });
+        report.Add("find_top.budget.partial_share"sv, queries.empty() ? 0.0 : partial_count * 1.0 / queries.size(), "ratio");
+        report.Add("find_top.budget.average_postings"sv, queries.empty() ? 0.0 : postings_scored * 1.0 / queries.size(), "postings");
+    }
+    {
+        // Один и тот же фильтр непрозрачной лямбдой и выражением document_filter
+        using namespace document_filter;
+        BenchmarkFindTop(report, "find_top.lambda_filter.seq"sv, queries, [&](const string &query)
+                         { return search_server->FindTopDocuments(execution::seq, query, [](int document_id, DocumentStatus status, int rating)
+                                                                  { return status == DocumentStatus::ACTUAL && rating >= 0 && document_id % 2 == 0; }); });
+        BenchmarkFindTop(report, "find_top.expression_filter.seq"sv, queries, [&](const string &query)
+                         { return search_server->FindTopDocuments(execution::seq, query, Status == DocumentStatus::ACTUAL && Rating >= 0 && Id % 2 == 0); });
+        // Лучшие по рейтингу среди документов с рейтингом не ниже 0
+        BenchmarkFindTop(report, "find_top.rating_order.seq"sv, queries, [&](const string &query)
+                         { return search_server->FindTopDocuments(execution::seq, query, Rating >= 0, ResultOrder::RATING); });
+    }
+
+    if (options.shards > 0 && options.analyzer == "none"s)
+    {
+        // Выдача совпадает с несегментированным сервером: контрольные суммы равны find_top.seq
+        unique_ptr<ShardedSearchServer> sharded_server;
+        report.Add("sharded.build.seconds"sv, MeasureMicroseconds([&]
+                                                                 { sharded_server = BuildShardedServer(dictionary, documents, options); }) /
+                                                   1e6,
+                   "s");
+        BenchmarkFindTop(report, "find_top.sharded.seq"sv, queries, [&](const string &query)
+                         { return sharded_server->FindTopDocuments(execution::seq, query); });
+        BenchmarkFindTop(report, "find_top.sharded.par"sv, queries, [&](const string &query)
+                         { return sharded_server->FindTopDocuments(execution::par, query); });
+    }
+
+    vector<int> match_ids(options.match_samples);
+    for (int &id : match_ids)
+    {
+        id = uniform_int_distribution<int>(0, options.documents - 1)(generator);
+    }
+    BenchmarkMatch(report, "match.seq"sv, *search_server, queries, match_ids, execution::seq);
+    BenchmarkMatch(report, "match.par"sv, *search_server, queries, match_ids, execution::par);
+    search_server->ResetExecutionStats();
+    BenchmarkMatch(report, "match.auto"sv, *search_server, queries, match_ids, search_execution::automatic);
+    ReportExecutionStats(report, "execution.match"sv, search_server->GetExecutionStats());
+    BenchmarkMatchAll(report, "match_all.seq"sv, *search_server, queries, options.match_all_queries, execution::seq);
+    BenchmarkMatchAll(report, "match_all.par"sv, *search_server, queries, options.match_all_queries, execution::par);
+
+    {
+        const double elapsed_us = MeasureMicroseconds([&]
+                                                      { ProcessQueries(*search_server, queries); });
+        report.Add("process_queries.throughput"sv, queries.size() / (elapsed_us / 1e6), "queries/s");
+    }
+    {
+        size_t result_count = 0;
+        const double elapsed_us = MeasureMicroseconds([&]
+                                                      { result_count = ProcessQueriesJoined(*search_server, queries).size(); });
+        report.Add("process_queries_joined.throughput"sv, queries.size() / (elapsed_us / 1e6), "queries/s");
+        report.Add("process_queries_joined.checksum"sv, result_count, "documents");
+    }
+
+    {
+        // Непересекающиеся выборки: по одному документу последовательно, параллельно и с выбором
+        // политики, затем одной пачкой
+        vector<int> ids(options.documents);
+        iota(ids.begin(), ids.end(), 0);
+        shuffle(ids.begin(), ids.end(), generator);
+        const size_t count = min<size_t>(options.remove_count, ids.size() / 4);
+        BenchmarkRemove(report, "remove.seq"sv, *search_server, vector<int>(ids.begin(), ids.begin() + count), execution::seq);
+        BenchmarkRemove(report, "remove.par"sv, *search_server, vector<int>(ids.begin() + count, ids.begin() + 2 * count), execution::par);
+        search_server->ResetExecutionStats();
+        BenchmarkRemove(report, "remove.auto"sv, *search_server, vector<int>(ids.begin() + 2 * count, ids.begin() + 3 * count), search_execution::automatic);
+        ReportExecutionStats(report, "execution.remove"sv, search_server->GetExecutionStats());
+        const vector<int> batch(ids.begin() + 3 * count, ids.begin() + 4 * count);
+        const double batch_us = MeasureMicroseconds([&]
+                                                    { search_server->RemoveDocuments(batch); });
+        report.Add("remove.batch.throughput"sv, batch.size() / (batch_us / 1e6), "docs/s");
+    }
+    search_server.reset();
+
+    {
+        // Корпус с известным числом дубликатов: копии случайных документов под новыми id
+        vector<string> corpus = documents;
+        const int duplicates = static_cast<int>(options.documents * options.duplicate_fraction);
+        for (int i = 0; i < duplicates && !documents.empty(); ++i)
+        {
+            corpus.push_back(documents[uniform_int_distribution<int>(0, documents.size() - 1)(generator)]);
+        }
+        // Шаблонный спам: largest_group должна быть не меньше spam_cluster
+        for (int i = 0; i < options.spam_cluster && !documents.empty(); ++i)
+        {
+            corpus.push_back(documents.front());
+        }
+        auto dedup_server = BuildServer(dictionary, corpus, options);
+        vector<vector<int>> near_duplicate_groups;
+        const double near_us = MeasureMicroseconds([&]
+                                                   { near_duplicate_groups = FindNearDuplicates(*dedup_server, 0.8); });
+        size_t largest_group = 0;
+        for (const vector<int> &group : near_duplicate_groups)
+        {
+            largest_group = max(largest_group, group.size());
+        }
+        report.Add("near_duplicates.seconds"sv, near_us / 1e6, "s");
+        report.Add("near_duplicates.groups"sv, near_duplicate_groups.size(), "groups");
+        report.Add("near_duplicates.largest_group"sv, largest_group, "documents");
+        ostringstream sink;
+        auto *old_buffer = cout.rdbuf(sink.rdbuf());
+        const double elapsed_us = MeasureMicroseconds([&]
+                                                      { RemoveDuplicates(*dedup_server); });
+        cout.rdbuf(old_buffer);
+        report.Add("remove_duplicates.seconds"sv, elapsed_us / 1e6, "s");
+        report.Add("remove_duplicates.removed"sv, corpus.size() - dedup_server->GetDocumentCount(), "documents");
+    }
+
+    report.Print(cout);
+    return 0;
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Вспомогательные средства для бенчмарков: замер латентности, перцентили,
+ * потребление памяти и отчёт в формате TSV (metric, value, unit),
+ * который можно сохранить как baseline и сравнить со следующим запуском.
+ */
+
+struct LatencySummary
+{
+    size_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+inline double Percentile(const std::vector<double> &sorted_samples, double percent)
+{
+    if (sorted_samples.empty())
+    {
+        return 0.0;
+    }
+    const size_t rank = static_cast<size_t>(percent / 100.0 * (sorted_samples.size() - 1) + 0.5);
+    return sorted_samples[std::min(rank, sorted_samples.size() - 1)];
+}
+
+inline LatencySummary Summarize(std::vector<double> samples)
+{
+    LatencySummary result;
+    if (samples.empty())
+    {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (const double sample : samples)
+    {
+        sum += sample;
+    }
+    result.count = samples.size();
+    result.mean = sum / samples.size();
+    result.p50 = Percentile(samples, 50.0);
+    result.p90 = Percentile(samples, 90.0);
+    result.p99 = Percentile(samples, 99.0);
+    result.p999 = Percentile(samples, 99.9);
+    result.max = samples.back();
+    return result;
+}
+
+// Замер с моментом завершения операции от начала прогона
+struct TimedSample
+{
+    double time_us = 0.0;
+    double latency_us = 0.0;
+};
+
+// Сводки по последовательным интервалам window_us по моменту завершения: латентность
+// и пропускная способность во времени. Интервал без операций даёт сводку с count = 0
+inline std::vector<LatencySummary> SummarizeWindows(const std::vector<TimedSample> &samples, double window_us)
+{
+    std::vector<std::vector<double>> windows;
+    for (const TimedSample &sample : samples)
+    {
+        const size_t window = static_cast<size_t>(std::max(sample.time_us, 0.0) / window_us);
+        if (windows.size() <= window)
+        {
+            windows.resize(window + 1);
+        }
+        windows[window].push_back(sample.latency_us);
+    }
+    std::vector<LatencySummary> result;
+    for (std::vector<double> &window : windows)
+    {
+        result.push_back(Summarize(std::move(window)));
+    }
+    return result;
+}
+
+// Время выполнения func в микросекундах
+template <typename Func>
+double MeasureMicroseconds(Func &&func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Resident set size процесса (VmRSS из /proc/self/status), 0 если недоступно
+inline size_t GetResidentMemoryBytes()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+        {
+            std::istringstream in(line.substr(6));
+            size_t kilobytes = 0;
+            in >> kilobytes;
+            return kilobytes * 1024;
+        }
+    }
+    return 0;
+}
+
+class BenchmarkReport
+{
+public:
+    void AddParameter(std::string_view name, const std::string &value)
+    {
+        parameters_.emplace_back(std::string(name), value);
+    }
+
+    void Add(std::string_view metric, double value, std::string_view unit)
+    {
+        metrics_.push_back({std::string(metric), value, std::string(unit)});
+    }
+
+    void AddLatency(std::string_view prefix, const LatencySummary &summary)
+    {
+        const std::string name(prefix);
+        Add(name + ".count", summary.count, "ops");
+        Add(name + ".mean", summary.mean, "us");
+        Add(name + ".p50", summary.p50, "us");
+        Add(name + ".p90", summary.p90, "us");
+        Add(name + ".p99", summary.p99, "us");
+        Add(name + ".p999", summary.p999, "us");
+        Add(name + ".max", summary.max, "us");
+    }
+
+    // Читает отчёт, ранее выведенный Print, и запоминает его метрики как baseline
+    bool LoadBaseline(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+            std::istringstream fields(line);
+            std::string metric;
+            double value = 0.0;
+            if (std::getline(fields, metric, '\t') && fields >> value)
+            {
+                baseline_[metric] = value;
+            }
+        }
+        return true;
+    }
+
+    void Print(std::ostream &out) const
+    {
+        for (const auto &[name, value] : parameters_)
+        {
+            out << "# " << name << '=' << value << '\n';
+        }
+        out << "# metric\tvalue\tunit";
+        if (!baseline_.empty())
+        {
+            out << "\tbaseline\tchange_pct";
+        }
+        out << '\n';
+        for (const Metric &metric : metrics_)
+        {
+            out << metric.name << '\t' << std::setprecision(10) << metric.value << '\t' << metric.unit;
+            if (!baseline_.empty())
+            {
+                const auto it = baseline_.find(metric.name);
+                if (it == baseline_.end())
+                {
+                    out << "\t-\t-";
+                }
+                else
+                {
+                    out << '\t' << it->second << '\t';
+                    if (it->second != 0.0)
+                    {
+                        out << std::setprecision(4) << (metric.value - it->second) / it->second * 100.0;
+                    }
+                    else
+                    {
+                        out << '-';
+                    }
+                }
+            }
+            out << '\n';
+        }
+        out.flush();
+    }
+
+private:
+    struct Metric
+    {
+        std::string name;
+        double value;
+        std::string unit;
+    };
+
+    std::vector<std::pair<std::string, std::string>> parameters_;
+    std::vector<Metric> metrics_;
+    std::map<std::string, double> baseline_;
+};
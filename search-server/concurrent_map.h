@@ -1,20 +1,151 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
 #include <map>
 #include <mutex>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 using namespace std::string_literals;
 
+// Размер кэш-линии: шарды выравниваются по нему, чтобы мьютексы соседних
+// шардов не делили одну линию (false sharing)
+inline constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Финализатор splitmix64: соседние id документов разбегаются по шардам и слотам
+inline uint64_t MixKey(uint64_t key)
+{
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+inline size_t RoundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * Потокобезопасный словарь с целочисленными ключами.
+ * Ключи распределяются по шардам (число шардов округляется до степени двойки),
+ * внутри шарда — открытая адресация с линейным пробированием вместо std::map.
+ * Access удерживает блокировку шарда, пока вызывающий работает со значением.
+ */
 template <typename Key, typename Value>
 class ConcurrentMap
 {
 private:
-    struct Bucket
+    class OpenTable
+    {
+    public:
+        Value &operator[](const Key &key)
+        {
+            if ((size_ + 1) * 2 > slots_.size())
+            {
+                Grow();
+            }
+            size_t index = FindSlot(key);
+            if (!slots_[index].used)
+            {
+                slots_[index] = {key, Value{}, true};
+                ++size_;
+            }
+            return slots_[index].value;
+        }
+
+        void erase(const Key &key)
+        {
+            if (slots_.empty())
+            {
+                return;
+            }
+            size_t hole = FindSlot(key);
+            if (!slots_[hole].used)
+            {
+                return;
+            }
+            // Удаление со сдвигом назад: цепочки пробирования остаются без "надгробий"
+            const size_t mask = slots_.size() - 1;
+            for (size_t next = (hole + 1) & mask; slots_[next].used; next = (next + 1) & mask)
+            {
+                const size_t home = MixKey(static_cast<uint64_t>(slots_[next].key)) & mask;
+                if (((next - home) & mask) >= ((next - hole) & mask))
+                {
+                    slots_[hole] = std::move(slots_[next]);
+                    hole = next;
+                }
+            }
+            slots_[hole].used = false;
+            slots_[hole].value = Value{};
+            --size_;
+        }
+
+        template <typename Func>
+        void ForEach(Func &&func) const
+        {
+            for (const Slot &slot : slots_)
+            {
+                if (slot.used)
+                {
+                    func(slot.key, slot.value);
+                }
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            Key key{};
+            Value value{};
+            bool used = false;
+        };
+
+        std::vector<Slot> slots_;
+        size_t size_ = 0;
+
+        size_t FindSlot(const Key &key) const
+        {
+            const size_t mask = slots_.size() - 1;
+            size_t index = MixKey(static_cast<uint64_t>(key)) & mask;
+            while (slots_[index].used && slots_[index].key != key)
+            {
+                index = (index + 1) & mask;
+            }
+            return index;
+        }
+
+        void Grow()
+        {
+            std::vector<Slot> old = std::move(slots_);
+            slots_ = std::vector<Slot>(old.empty() ? 8 : old.size() * 2);
+            size_ = 0;
+            for (Slot &slot : old)
+            {
+                if (slot.used)
+                {
+                    (*this)[slot.key] = std::move(slot.value);
+                }
+            }
+        }
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Shard
     {
         std::mutex mutex;
-        std::map<Key, Value> map;
+        OpenTable table;
     };
 
 public:
@@ -25,41 +156,152 @@ public:
         std::lock_guard<std::mutex> guard;
         Value &ref_to_value;
 
-        Access(const Key &key, Bucket &bucket)
-            : guard(bucket.mutex), ref_to_value(bucket.map[key])
+        Access(const Key &key, Shard &shard)
+            : guard(shard.mutex), ref_to_value(shard.table[key])
         {
         }
     };
 
-    explicit ConcurrentMap(size_t bucket_count)
-        : buckets_(bucket_count)
+    explicit ConcurrentMap(size_t shard_count)
+        : shards_(RoundUpToPowerOfTwo(std::max<size_t>(shard_count, 1)))
     {
     }
 
     Access operator[](const Key &key)
     {
-        auto &bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        return {key, bucket};
+        return {key, GetShard(key)};
     }
 
     std::map<Key, Value> BuildOrdinaryMap()
     {
         std::map<Key, Value> result;
-        for (auto &[mutex, map] : buckets_)
+        for (Shard &shard : shards_)
         {
-            std::lock_guard g(mutex);
-            result.insert(map.begin(), map.end());
+            std::lock_guard g(shard.mutex);
+            shard.table.ForEach([&result](const Key &key, const Value &value)
+                                { result.emplace(key, value); });
         }
         return result;
     }
 
     void erase(const Key &key)
     {
-        auto &bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        std::lock_guard guard(bucket.mutex);
-        bucket.map.erase(key);
+        Shard &shard = GetShard(key);
+        std::lock_guard guard(shard.mutex);
+        shard.table.erase(key);
+    }
+
+private:
+    std::vector<Shard> shards_;
+
+    Shard &GetShard(const Key &key)
+    {
+        // Старшие биты хэша выбирают шард, младшие — слот внутри шарда
+        return shards_[(MixKey(static_cast<uint64_t>(key)) >> 40) & (shards_.size() - 1)];
+    }
+};
+
+/**
+ * Неблокирующий словарь фиксированной ёмкости для накопления числовых значений
+ * (например, релевантности документов при параллельном поиске).
+ * Слот занимается CAS-ом ключа, значение обновляется атомарным FetchAdd,
+ * для double — циклом compare_exchange. Ключ std::numeric_limits<Key>::max()
+ * зарезервирован под пустой слот.
+ * Exclude помечает ключ исключённым до конца жизни словаря: последующие FetchAdd
+ * для него ни на что не влияют, а обход его пропускает.
+ */
+template <typename Key, typename Value>
+class AtomicConcurrentMap
+{
+public:
+    static_assert(std::is_integral_v<Key>, "AtomicConcurrentMap supports only integer keys"s);
+    static_assert(std::is_arithmetic_v<Value>, "AtomicConcurrentMap supports only arithmetic values"s);
+
+    // max_key_count — верхняя оценка числа различных ключей
+    explicit AtomicConcurrentMap(size_t max_key_count)
+        : slots_(RoundUpToPowerOfTwo(std::max<size_t>(max_key_count * 2, 16)))
+    {
+    }
+
+    void FetchAdd(const Key &key, Value delta)
+    {
+        Slot &slot = Acquire(key);
+        if (slot.excluded.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        if constexpr (std::is_integral_v<Value>)
+        {
+            slot.value.fetch_add(delta, std::memory_order_relaxed);
+        }
+        else
+        {
+            Value expected = slot.value.load(std::memory_order_relaxed);
+            while (!slot.value.compare_exchange_weak(expected, expected + delta, std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    void Exclude(const Key &key)
+    {
+        Acquire(key).excluded.store(true, std::memory_order_relaxed);
+    }
+
+    // Обход не синхронизирован с писателями: вызывать после завершения обновлений
+    template <typename Func>
+    void ForEach(Func &&func) const
+    {
+        for (const Slot &slot : slots_)
+        {
+            const Key key = slot.key.load(std::memory_order_relaxed);
+            if (key != EMPTY_KEY && !slot.excluded.load(std::memory_order_relaxed))
+            {
+                func(key, slot.value.load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    std::map<Key, Value> BuildOrdinaryMap() const
+    {
+        std::map<Key, Value> result;
+        ForEach([&result](const Key &key, Value value)
+                { result.emplace(key, value); });
+        return result;
     }
 
 private:
-    std::vector<Bucket> buckets_;
-};
\ No newline at end of file
+    static constexpr Key EMPTY_KEY = std::numeric_limits<Key>::max();
+
+    struct Slot
+    {
+        std::atomic<Key> key{EMPTY_KEY};
+        std::atomic<bool> excluded{false};
+        std::atomic<Value> value{Value{}};
+    };
+
+    std::vector<Slot> slots_;
+
+    Slot &Acquire(const Key &key)
+    {
+        const size_t mask = slots_.size() - 1;
+        size_t index = MixKey(static_cast<uint64_t>(key)) & mask;
+        for (size_t probe = 0; probe < slots_.size(); ++probe, index = (index + 1) & mask)
+        {
+            Key current = slots_[index].key.load(std::memory_order_relaxed);
+            if (current == EMPTY_KEY)
+            {
+                // При неудаче current получает ключ, успевший занять слот
+                if (slots_[index].key.compare_exchange_strong(current, key, std::memory_order_relaxed) || current == key)
+                {
+                    return slots_[index];
+                }
+            }
+            else if (current == key)
+            {
+                return slots_[index];
+            }
+        }
+        throw std::length_error("AtomicConcurrentMap capacity exceeded"s);
+    }
+};
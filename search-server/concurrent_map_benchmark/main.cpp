@@ -0,0 +1,272 @@
+// Микробенчмарк конкурентного доступа к словарям из concurrent_map.h.
+// Перебирает число потоков и распределения ключей, выводит пропускную
+// способность в формате BenchmarkReport (TSV, можно сравнивать с baseline).
+//
+// Сборка (из каталога search-server/concurrent_map_benchmark):
+//   g++ --std=c++17 -O2 -pthread main.cpp -o build/main
+//
+// Пример:
+//   ./build/main --max-threads=64 --keys=100000 --ops=1000000
+
+#include "../concurrent_map.h"
+#include "../benchmark_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct BenchmarkOptions
+{
+    int max_threads = max(1u, thread::hardware_concurrency());
+    int keys = 100'000;
+    int ops = 1'000'000;
+    int shards = 64;
+    double zipf_exponent = 1.0;
+    string baseline;
+};
+
+BenchmarkOptions ParseOptions(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg = argv[i];
+        const auto eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos)
+        {
+            throw invalid_argument("Expected --name=value, got "s + string(arg));
+        }
+        const string_view name = arg.substr(2, eq - 2);
+        const string value(arg.substr(eq + 1));
+        if (name == "max-threads"sv)
+        {
+            options.max_threads = stoi(value);
+        }
+        else if (name == "keys"sv)
+        {
+            options.keys = stoi(value);
+        }
+        else if (name == "ops"sv)
+        {
+            options.ops = stoi(value);
+        }
+        else if (name == "shards"sv)
+        {
+            options.shards = stoi(value);
+        }
+        else if (name == "zipf-exponent"sv)
+        {
+            options.zipf_exponent = stod(value);
+        }
+        else if (name == "baseline"sv)
+        {
+            options.baseline = value;
+        }
+        else
+        {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    return options;
+}
+
+enum class KeyDistribution
+{
+    UNIFORM,
+    ZIPF,
+    SEQUENTIAL,
+};
+
+string_view GetDistributionName(KeyDistribution distribution)
+{
+    switch (distribution)
+    {
+    case KeyDistribution::UNIFORM:
+        return "uniform"sv;
+    case KeyDistribution::ZIPF:
+        return "zipf"sv;
+    case KeyDistribution::SEQUENTIAL:
+        return "sequential"sv;
+    }
+    return "unknown"sv;
+}
+
+// Ключи для каждого потока генерируются заранее, чтобы генератор не попадал в замер
+vector<vector<int>> GenerateKeys(KeyDistribution distribution, const BenchmarkOptions &options, int threads)
+{
+    vector<double> zipf_cdf;
+    if (distribution == KeyDistribution::ZIPF)
+    {
+        zipf_cdf.resize(options.keys);
+        double sum = 0;
+        for (int k = 0; k < options.keys; ++k)
+        {
+            sum += 1.0 / pow(k + 1, options.zipf_exponent);
+            zipf_cdf[k] = sum;
+        }
+        for (double &value : zipf_cdf)
+        {
+            value /= sum;
+        }
+    }
+
+    vector<vector<int>> result(threads);
+    const int ops_per_thread = options.ops / threads;
+    for (int t = 0; t < threads; ++t)
+    {
+        mt19937 generator(t + 1);
+        auto &keys = result[t];
+        keys.reserve(ops_per_thread);
+        for (int i = 0; i < ops_per_thread; ++i)
+        {
+            switch (distribution)
+            {
+            case KeyDistribution::UNIFORM:
+                keys.push_back(uniform_int_distribution<int>(0, options.keys - 1)(generator));
+                break;
+            case KeyDistribution::ZIPF:
+            {
+                const double u = uniform_real_distribution<>(0, 1)(generator);
+                keys.push_back(static_cast<int>(lower_bound(zipf_cdf.begin(), zipf_cdf.end(), u) - zipf_cdf.begin()));
+                break;
+            }
+            case KeyDistribution::SEQUENTIAL:
+                // Каждый поток идёт по своему непрерывному диапазону, как при обходе posting-листов
+                keys.push_back((t * ops_per_thread + i) % options.keys);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// Запускает update для каждого ключа во всех потоках одновременно, возвращает млн операций в секунду
+template <typename Update>
+double RunThreads(const vector<vector<int>> &keys, Update update)
+{
+    atomic_bool start = false;
+    vector<thread> workers;
+    workers.reserve(keys.size());
+    for (const auto &thread_keys : keys)
+    {
+        workers.emplace_back([&start, &thread_keys, &update]
+                             {
+                                 while (!start.load(memory_order_acquire))
+                                 {
+                                     this_thread::yield();
+                                 }
+                                 for (const int key : thread_keys)
+                                 {
+                                     update(key);
+                                 } });
+    }
+    size_t total_ops = 0;
+    for (const auto &thread_keys : keys)
+    {
+        total_ops += thread_keys.size();
+    }
+    const double elapsed_us = MeasureMicroseconds([&]
+                                                  {
+                                                      start.store(true, memory_order_release);
+                                                      for (thread &worker : workers)
+                                                      {
+                                                          worker.join();
+                                                      } });
+    return total_ops / elapsed_us;
+}
+
+double Total(const map<int, double> &values)
+{
+    double sum = 0;
+    for (const auto &[key, value] : values)
+    {
+        sum += value;
+    }
+    return sum;
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    try
+    {
+        options = ParseOptions(argc, argv);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    BenchmarkReport report;
+    report.AddParameter("max_threads"sv, to_string(options.max_threads));
+    report.AddParameter("keys"sv, to_string(options.keys));
+    report.AddParameter("ops"sv, to_string(options.ops));
+    report.AddParameter("shards"sv, to_string(options.shards));
+    report.AddParameter("zipf_exponent"sv, to_string(options.zipf_exponent));
+    if (!options.baseline.empty() && !report.LoadBaseline(options.baseline))
+    {
+        cerr << "Cannot read baseline "s << options.baseline << endl;
+        return 1;
+    }
+
+    vector<int> thread_counts;
+    for (int threads = 1; threads < options.max_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(options.max_threads);
+
+    bool consistent = true;
+    for (const KeyDistribution distribution : {KeyDistribution::UNIFORM, KeyDistribution::ZIPF, KeyDistribution::SEQUENTIAL})
+    {
+        for (const int threads : thread_counts)
+        {
+            const auto keys = GenerateKeys(distribution, options, threads);
+            const double expected = static_cast<double>(options.ops / threads) * threads;
+            const string suffix = "."s + string(GetDistributionName(distribution)) + ".t"s + to_string(threads) + ".throughput"s;
+
+            {
+                // Один мьютекс на std::map — нижняя граница, с которой сравниваем
+                mutex m;
+                map<int, double> values;
+                report.Add("single_mutex_map"s + suffix, RunThreads(keys, [&](int key)
+                                                                     {
+                                                                         lock_guard guard(m);
+                                                                         values[key] += 1.0; }),
+                           "Mops/s");
+                consistent = consistent && Total(values) == expected;
+            }
+            {
+                ConcurrentMap<int, double> values(options.shards);
+                report.Add("sharded_map"s + suffix, RunThreads(keys, [&](int key)
+                                                                { values[key].ref_to_value += 1.0; }),
+                           "Mops/s");
+                consistent = consistent && Total(values.BuildOrdinaryMap()) == expected;
+            }
+            {
+                AtomicConcurrentMap<int, double> values(options.keys);
+                report.Add("atomic_map"s + suffix, RunThreads(keys, [&](int key)
+                                                               { values.FetchAdd(key, 1.0); }),
+                           "Mops/s");
+                consistent = consistent && Total(values.BuildOrdinaryMap()) == expected;
+            }
+        }
+    }
+
+    report.Print(cout);
+    if (!consistent)
+    {
+        cerr << "Concurrent map lost updates"s << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "document_columns.h"
+
+DocumentColumns::Slot DocumentColumns::Add(int document_id, int rating, DocumentStatus status)
+{
+    Slot slot = 0;
+    if (free_slots_.empty())
+    {
+        slot = static_cast<Slot>(ids_.size());
+        ids_.push_back(document_id);
+        ratings_.push_back(rating);
+        statuses_.push_back(status);
+        for (auto &bitmap : status_bitmaps_)
+        {
+            bitmap.resize((ids_.size() + 63) / 64);
+        }
+    }
+    else
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        ids_[slot] = document_id;
+        ratings_[slot] = rating;
+        statuses_[slot] = status;
+    }
+    SetStatusBit(slot, status, true);
+    rating_index_.Add(slot, rating);
+    return slot;
+}
+
+void DocumentColumns::Remove(Slot slot)
+{
+    SetStatusBit(slot, statuses_[slot], false);
+    rating_index_.Remove(slot, ratings_[slot]);
+    free_slots_.push_back(slot);
+}
+
+std::vector<DocumentColumns::Slot> DocumentColumns::Renumber(const std::vector<Slot> &order)
+{
+    DocumentColumns renumbered;
+    std::vector<Slot> new_slots(ids_.size(), 0);
+    for (const Slot slot : order)
+    {
+        new_slots[slot] = renumbered.Add(ids_[slot], ratings_[slot], statuses_[slot]);
+    }
+    *this = std::move(renumbered);
+    return new_slots;
+}
+
+void DocumentColumns::SetStatusBit(Slot slot, DocumentStatus status, bool value)
+{
+    const auto index = static_cast<size_t>(status);
+    if (index >= STATUS_COUNT)
+    {
+        return;
+    }
+    const uint64_t bit = uint64_t{1} << (slot & 63);
+    if (value)
+    {
+        status_bitmaps_[index][slot >> 6] |= bit;
+    }
+    else
+    {
+        status_bitmaps_[index][slot >> 6] &= ~bit;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "document.h"
+#include "rating_index.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Атрибуты документов в плотных столбцах по внутреннему номеру документа (слоту).
+ * Слоты удалённых документов переиспользуются. Для каждого статуса хранится
+ * битовая карта занятых слотов, так что фильтр по статусу — проверка одного бита
+ * без обращения к словарю документов. По рейтингу поддерживается RatingIndex.
+ */
+class DocumentColumns
+{
+public:
+    using Slot = uint32_t;
+    static constexpr size_t STATUS_COUNT = 4;
+
+    Slot Add(int document_id, int rating, DocumentStatus status);
+    void Remove(Slot slot);
+    // Переставляет документы: order — занятые слоты в новом порядке, документ order[i]
+    // получает слот i, свободные слоты пропадают. Возвращает новый слот по старому
+    std::vector<Slot> Renumber(const std::vector<Slot> &order);
+
+    int GetId(Slot slot) const
+    {
+        return ids_[slot];
+    }
+
+    int GetRating(Slot slot) const
+    {
+        return ratings_[slot];
+    }
+
+    DocumentStatus GetStatus(Slot slot) const
+    {
+        return statuses_[slot];
+    }
+
+    bool HasStatus(Slot slot, DocumentStatus status) const
+    {
+        const auto index = static_cast<size_t>(status);
+        // Для значений вне перечисления битовых карт нет
+        if (index >= STATUS_COUNT)
+        {
+            return statuses_[slot] == status;
+        }
+        return status_bitmaps_[index][slot >> 6] >> (slot & 63) & 1;
+    }
+
+    // Слоты со статусом status; status должен быть меньше STATUS_COUNT
+    const std::vector<uint64_t> &GetStatusBitmap(DocumentStatus status) const
+    {
+        return status_bitmaps_[static_cast<size_t>(status)];
+    }
+
+    const RatingIndex &GetRatingIndex() const
+    {
+        return rating_index_;
+    }
+
+    // Число слотов вместе со свободными
+    size_t GetSlotCount() const
+    {
+        return ids_.size();
+    }
+
+private:
+    std::vector<int> ids_;
+    std::vector<int> ratings_;
+    std::vector<DocumentStatus> statuses_;
+    std::array<std::vector<uint64_t>, STATUS_COUNT> status_bitmaps_;
+    std::vector<Slot> free_slots_;
+    RatingIndex rating_index_;
+
+    void SetStatusBit(Slot slot, DocumentStatus status, bool value);
+};
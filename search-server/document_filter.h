@@ -0,0 +1,381 @@
+#pragma once
+#include "document.h"
+#include "document_columns.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/**
+ * Фильтры документов в виде выражений, разбираемых на этапе компиляции:
+ *
+ *   using namespace document_filter;
+ *   server.FindTopDocuments(query, Status == DocumentStatus::ACTUAL && Rating >= 3 && Id % 2 == 0);
+ *
+ * Выражение остаётся обычным предикатом (id, status, rating) и подходит везде, где
+ * принимается предикат. SearchServer распознаёт его по типу и вычисляет без косвенных
+ * вызовов прямо по столбцам атрибутов: сравнение статуса — бит в карте статуса, остальные
+ * узлы — чтение столбцов. Для выборок, затрагивающих заметную долю документов, всё
+ * выражение заранее сворачивается в битовую карту слотов по 64 документа за операцию.
+ */
+namespace document_filter
+{
+    // Метка узла выражения: по ней сервер отличает выражения от произвольных предикатов
+    struct ExpressionTag
+    {
+    };
+
+    template <typename T>
+    inline constexpr bool IS_EXPRESSION = std::is_base_of_v<ExpressionTag, T>;
+
+    // Маска из 64 слотов, начиная с word * 64, для которых выполняется выражение
+    template <typename Expression>
+    uint64_t SelectWordBySlots(const Expression &expression, const DocumentColumns &columns, size_t word)
+    {
+        const size_t begin = word * 64;
+        const size_t end = std::min(begin + 64, columns.GetSlotCount());
+        uint64_t mask = 0;
+        for (size_t slot = begin; slot < end; ++slot)
+        {
+            mask |= uint64_t{expression.Matches(columns, static_cast<DocumentColumns::Slot>(slot))} << (slot - begin);
+        }
+        return mask;
+    }
+
+    struct StatusIs : ExpressionTag
+    {
+        DocumentStatus status;
+
+        explicit StatusIs(DocumentStatus status)
+            : status(status)
+        {
+        }
+
+        bool operator()(int, DocumentStatus document_status, int) const
+        {
+            return document_status == status;
+        }
+
+        bool Matches(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return columns.HasStatus(slot, status);
+        }
+
+        uint64_t SelectWord(const DocumentColumns &columns, size_t word) const
+        {
+            if (static_cast<size_t>(status) >= DocumentColumns::STATUS_COUNT)
+            {
+                return SelectWordBySlots(*this, columns, word);
+            }
+            return columns.GetStatusBitmap(status)[word];
+        }
+    };
+
+    // Числовые поля документа: значение по аргументам предиката и по столбцам
+    struct RatingField
+    {
+        int Get(int, DocumentStatus, int rating) const
+        {
+            return rating;
+        }
+
+        int Get(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return columns.GetRating(slot);
+        }
+    };
+
+    struct IdField
+    {
+        int Get(int document_id, DocumentStatus, int) const
+        {
+            return document_id;
+        }
+
+        int Get(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return columns.GetId(slot);
+        }
+    };
+
+    template <typename Field>
+    struct ModuloField
+    {
+        Field field;
+        int divisor;
+
+        int Get(int document_id, DocumentStatus status, int rating) const
+        {
+            return field.Get(document_id, status, rating) % divisor;
+        }
+
+        int Get(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return field.Get(columns, slot) % divisor;
+        }
+    };
+
+    template <typename T>
+    inline constexpr bool IS_FIELD = std::is_same_v<T, RatingField> || std::is_same_v<T, IdField>;
+
+    template <typename Field>
+    inline constexpr bool IS_FIELD<ModuloField<Field>> = true;
+
+    template <typename Field, typename Compare>
+    struct FieldCompare : ExpressionTag
+    {
+        Field field;
+        int value;
+
+        FieldCompare(Field field, int value)
+            : field(field), value(value)
+        {
+        }
+
+        bool operator()(int document_id, DocumentStatus status, int rating) const
+        {
+            return Compare{}(field.Get(document_id, status, rating), value);
+        }
+
+        bool Matches(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return Compare{}(field.Get(columns, slot), value);
+        }
+
+        uint64_t SelectWord(const DocumentColumns &columns, size_t word) const
+        {
+            return SelectWordBySlots(*this, columns, word);
+        }
+    };
+
+    // Рейтинг в [min_rating, max_rating]: отбирается по индексу рейтингов
+    struct RatingRange : ExpressionTag
+    {
+        // Дальше этого числа рейтингов в диапазоне дешевле проверить 64 слота по столбцу
+        static constexpr size_t MAX_INDEXED_RATINGS = 16;
+
+        int min_rating;
+        int max_rating;
+
+        RatingRange(int min_rating, int max_rating)
+            : min_rating(min_rating), max_rating(max_rating)
+        {
+        }
+
+        bool operator()(int, DocumentStatus, int rating) const
+        {
+            return min_rating <= rating && rating <= max_rating;
+        }
+
+        bool Matches(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            const int rating = columns.GetRating(slot);
+            return min_rating <= rating && rating <= max_rating;
+        }
+
+        uint64_t SelectWord(const DocumentColumns &columns, size_t word) const
+        {
+            const RatingIndex &index = columns.GetRatingIndex();
+            if (index.CountRatings(min_rating, max_rating, MAX_INDEXED_RATINGS + 1) > MAX_INDEXED_RATINGS)
+            {
+                return SelectWordBySlots(*this, columns, word);
+            }
+            return index.SelectWord(min_rating, max_rating, word);
+        }
+    };
+
+    template <typename Lhs, typename Rhs>
+    struct And : ExpressionTag
+    {
+        Lhs lhs;
+        Rhs rhs;
+
+        And(Lhs lhs, Rhs rhs)
+            : lhs(lhs), rhs(rhs)
+        {
+        }
+
+        bool operator()(int document_id, DocumentStatus status, int rating) const
+        {
+            return lhs(document_id, status, rating) && rhs(document_id, status, rating);
+        }
+
+        bool Matches(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return lhs.Matches(columns, slot) && rhs.Matches(columns, slot);
+        }
+
+        uint64_t SelectWord(const DocumentColumns &columns, size_t word) const
+        {
+            const uint64_t mask = lhs.SelectWord(columns, word);
+            return mask == 0 ? 0 : mask & rhs.SelectWord(columns, word);
+        }
+    };
+
+    template <typename Lhs, typename Rhs>
+    struct Or : ExpressionTag
+    {
+        Lhs lhs;
+        Rhs rhs;
+
+        Or(Lhs lhs, Rhs rhs)
+            : lhs(lhs), rhs(rhs)
+        {
+        }
+
+        bool operator()(int document_id, DocumentStatus status, int rating) const
+        {
+            return lhs(document_id, status, rating) || rhs(document_id, status, rating);
+        }
+
+        bool Matches(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return lhs.Matches(columns, slot) || rhs.Matches(columns, slot);
+        }
+
+        uint64_t SelectWord(const DocumentColumns &columns, size_t word) const
+        {
+            return lhs.SelectWord(columns, word) | rhs.SelectWord(columns, word);
+        }
+    };
+
+    template <typename Operand>
+    struct Not : ExpressionTag
+    {
+        Operand operand;
+
+        explicit Not(Operand operand)
+            : operand(operand)
+        {
+        }
+
+        bool operator()(int document_id, DocumentStatus status, int rating) const
+        {
+            return !operand(document_id, status, rating);
+        }
+
+        bool Matches(const DocumentColumns &columns, DocumentColumns::Slot slot) const
+        {
+            return !operand.Matches(columns, slot);
+        }
+
+        // Биты свободных слотов и слотов за концом столбцов не важны: в индексе их нет
+        uint64_t SelectWord(const DocumentColumns &columns, size_t word) const
+        {
+            return ~operand.SelectWord(columns, word);
+        }
+    };
+
+    struct StatusField
+    {
+    };
+
+    inline constexpr StatusField Status{};
+    inline constexpr RatingField Rating{};
+    inline constexpr IdField Id{};
+
+    inline StatusIs operator==(StatusField, DocumentStatus status)
+    {
+        return StatusIs(status);
+    }
+
+    inline Not<StatusIs> operator!=(StatusField, DocumentStatus status)
+    {
+        return Not<StatusIs>(StatusIs(status));
+    }
+
+    template <typename Field, typename = std::enable_if_t<IS_FIELD<Field>>>
+    ModuloField<Field> operator%(Field field, int divisor)
+    {
+        using std::string_literals::operator""s;
+
+        if (divisor == 0)
+        {
+            throw std::invalid_argument("Filter divisor must be non-zero"s);
+        }
+        return {field, divisor};
+    }
+
+    // Сравнения рейтинга, кроме !=, — диапазоны
+    inline RatingRange operator==(RatingField, int value)
+    {
+        return {value, value};
+    }
+
+    inline RatingRange operator<(RatingField, int value)
+    {
+        return value == std::numeric_limits<int>::min() ? RatingRange(1, 0) : RatingRange(std::numeric_limits<int>::min(), value - 1);
+    }
+
+    inline RatingRange operator<=(RatingField, int value)
+    {
+        return {std::numeric_limits<int>::min(), value};
+    }
+
+    inline RatingRange operator>(RatingField, int value)
+    {
+        return value == std::numeric_limits<int>::max() ? RatingRange(1, 0) : RatingRange(value + 1, std::numeric_limits<int>::max());
+    }
+
+    inline RatingRange operator>=(RatingField, int value)
+    {
+        return {value, std::numeric_limits<int>::max()};
+    }
+
+    template <typename Field, typename = std::enable_if_t<IS_FIELD<Field>>>
+    FieldCompare<Field, std::equal_to<>> operator==(Field field, int value)
+    {
+        return {field, value};
+    }
+
+    template <typename Field, typename = std::enable_if_t<IS_FIELD<Field>>>
+    FieldCompare<Field, std::not_equal_to<>> operator!=(Field field, int value)
+    {
+        return {field, value};
+    }
+
+    template <typename Field, typename = std::enable_if_t<IS_FIELD<Field>>>
+    FieldCompare<Field, std::less<>> operator<(Field field, int value)
+    {
+        return {field, value};
+    }
+
+    template <typename Field, typename = std::enable_if_t<IS_FIELD<Field>>>
+    FieldCompare<Field, std::less_equal<>> operator<=(Field field, int value)
+    {
+        return {field, value};
+    }
+
+    template <typename Field, typename = std::enable_if_t<IS_FIELD<Field>>>
+    FieldCompare<Field, std::greater<>> operator>(Field field, int value)
+    {
+        return {field, value};
+    }
+
+    template <typename Field, typename = std::enable_if_t<IS_FIELD<Field>>>
+    FieldCompare<Field, std::greater_equal<>> operator>=(Field field, int value)
+    {
+        return {field, value};
+    }
+
+    template <typename Lhs, typename Rhs, typename = std::enable_if_t<IS_EXPRESSION<Lhs> && IS_EXPRESSION<Rhs>>>
+    And<Lhs, Rhs> operator&&(const Lhs &lhs, const Rhs &rhs)
+    {
+        return {lhs, rhs};
+    }
+
+    template <typename Lhs, typename Rhs, typename = std::enable_if_t<IS_EXPRESSION<Lhs> && IS_EXPRESSION<Rhs>>>
+    Or<Lhs, Rhs> operator||(const Lhs &lhs, const Rhs &rhs)
+    {
+        return {lhs, rhs};
+    }
+
+    template <typename Operand, typename = std::enable_if_t<IS_EXPRESSION<Operand>>>
+    Not<Operand> operator!(const Operand &operand)
+    {
+        return Not<Operand>(operand);
+    }
+}
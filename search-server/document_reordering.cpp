@@ -0,0 +1,226 @@
+#include "document_reordering.h"
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using TermIds = std::vector<SearchServer::TermId>;
+
+    // Оценка числа бит на degree записей слова в части из size документов: при равномерном
+    // разбросе разность соседних номеров около size / (degree + 1)
+    double GapCost(size_t degree, size_t size)
+    {
+        return degree * std::log2(static_cast<double>(size) / (degree + 1));
+    }
+
+    size_t VarintSize(size_t value)
+    {
+        size_t size = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            ++size;
+        }
+        return size;
+    }
+
+    class Bisection
+    {
+    public:
+        Bisection(std::vector<const TermIds *> documents, size_t term_count, const BisectionOptions &options)
+            : documents_(std::move(documents)),
+              options_(options),
+              order_(documents_.size()),
+              gains_(documents_.size()),
+              left_degrees_(term_count, 0),
+              right_degrees_(term_count, 0),
+              to_right_gains_(term_count, 0.0),
+              to_left_gains_(term_count, 0.0)
+        {
+            std::iota(order_.begin(), order_.end(), 0);
+        }
+
+        // Номера документов в исходном векторе в новом порядке
+        std::vector<size_t> Run()
+        {
+            Bisect(0, order_.size());
+            return std::move(order_);
+        }
+
+    private:
+        std::vector<const TermIds *> documents_;
+        BisectionOptions options_;
+        std::vector<size_t> order_;
+        std::vector<double> gains_;
+        // Степени слов в левой и правой половине текущей части и выигрыш от переноса
+        // документа со словом в другую половину; ненулевые только для слов из touched_terms_
+        std::vector<uint32_t> left_degrees_;
+        std::vector<uint32_t> right_degrees_;
+        std::vector<double> to_right_gains_;
+        std::vector<double> to_left_gains_;
+        std::vector<SearchServer::TermId> touched_terms_;
+
+        void Bisect(size_t begin, size_t end)
+        {
+            if (end - begin <= options_.min_partition_size)
+            {
+                return;
+            }
+            const size_t middle = begin + (end - begin) / 2;
+            touched_terms_.clear();
+            for (size_t position = begin; position < end; ++position)
+            {
+                for (const SearchServer::TermId term_id : *documents_[order_[position]])
+                {
+                    if (left_degrees_[term_id] == 0 && right_degrees_[term_id] == 0)
+                    {
+                        touched_terms_.push_back(term_id);
+                    }
+                    ++(position < middle ? left_degrees_ : right_degrees_)[term_id];
+                }
+            }
+
+            for (int iteration = 0; iteration < options_.iterations; ++iteration)
+            {
+                if (SwapDocuments(begin, middle, end) == 0)
+                {
+                    break;
+                }
+            }
+
+            for (const SearchServer::TermId term_id : touched_terms_)
+            {
+                left_degrees_[term_id] = 0;
+                right_degrees_[term_id] = 0;
+            }
+            Bisect(begin, middle);
+            Bisect(middle, end);
+        }
+
+        // Одна итерация: документы обеих половин упорядочиваются по выигрышу от переноса,
+        // и пары меняются местами, пока суммарный выигрыш пары положителен
+        size_t SwapDocuments(size_t begin, size_t middle, size_t end)
+        {
+            const size_t left_size = middle - begin;
+            const size_t right_size = end - middle;
+            for (const SearchServer::TermId term_id : touched_terms_)
+            {
+                const size_t left = left_degrees_[term_id];
+                const size_t right = right_degrees_[term_id];
+                const double cost = GapCost(left, left_size) + GapCost(right, right_size);
+                to_right_gains_[term_id] = left == 0 ? 0.0 : cost - GapCost(left - 1, left_size) - GapCost(right + 1, right_size);
+                to_left_gains_[term_id] = right == 0 ? 0.0 : cost - GapCost(left + 1, left_size) - GapCost(right - 1, right_size);
+            }
+            const auto compute_gains = [this](size_t first, size_t last, const std::vector<double> &term_gains)
+            {
+                std::transform(std::execution::par,
+                               order_.begin() + first, order_.begin() + last,
+                               gains_.begin() + first,
+                               [this, &term_gains](size_t document)
+                               {
+                                   double gain = 0.0;
+                                   for (const SearchServer::TermId term_id : *documents_[document])
+                                   {
+                                       gain += term_gains[term_id];
+                                   }
+                                   return gain;
+                               });
+            };
+            compute_gains(begin, middle, to_right_gains_);
+            compute_gains(middle, end, to_left_gains_);
+
+            const auto by_gain = [this](size_t first, size_t last)
+            {
+                std::vector<size_t> positions(last - first);
+                std::iota(positions.begin(), positions.end(), first);
+                std::sort(positions.begin(), positions.end(), [this](size_t lhs, size_t rhs)
+                          { return gains_[lhs] != gains_[rhs] ? gains_[lhs] > gains_[rhs] : lhs < rhs; });
+                return positions;
+            };
+            const std::vector<size_t> left_positions = by_gain(begin, middle);
+            const std::vector<size_t> right_positions = by_gain(middle, end);
+
+            size_t swaps = 0;
+            for (; swaps < left_positions.size() && swaps < right_positions.size(); ++swaps)
+            {
+                const size_t left_position = left_positions[swaps];
+                const size_t right_position = right_positions[swaps];
+                if (gains_[left_position] + gains_[right_position] <= 0.0)
+                {
+                    break;
+                }
+                for (const SearchServer::TermId term_id : *documents_[order_[left_position]])
+                {
+                    --left_degrees_[term_id];
+                    ++right_degrees_[term_id];
+                }
+                for (const SearchServer::TermId term_id : *documents_[order_[right_position]])
+                {
+                    ++left_degrees_[term_id];
+                    --right_degrees_[term_id];
+                }
+                std::swap(order_[left_position], order_[right_position]);
+            }
+            return swaps;
+        }
+    };
+}
+
+std::vector<int> ComputeBisectionOrder(const SearchServer &search_server)
+{
+    return ComputeBisectionOrder(search_server, BisectionOptions());
+}
+
+std::vector<int> ComputeBisectionOrder(const SearchServer &search_server, const BisectionOptions &options)
+{
+    const std::vector<int> document_ids = search_server.GetDocumentOrder();
+    std::vector<const TermIds *> documents;
+    documents.reserve(document_ids.size());
+    size_t term_count = 0;
+    for (const int document_id : document_ids)
+    {
+        const TermIds &term_ids = search_server.GetDocumentTermIds(document_id);
+        if (!term_ids.empty())
+        {
+            term_count = std::max<size_t>(term_count, term_ids.back() + 1);
+        }
+        documents.push_back(&term_ids);
+    }
+
+    std::vector<int> result;
+    result.reserve(document_ids.size());
+    for (const size_t document : Bisection(std::move(documents), term_count, options).Run())
+    {
+        result.push_back(document_ids[document]);
+    }
+    return result;
+}
+
+PostingGapStats MeasurePostingGaps(const SearchServer &search_server, const std::vector<int> &document_order)
+{
+    PostingGapStats stats;
+    // Номер последнего документа со словом плюс один, 0 — слово ещё не встречалось
+    std::vector<size_t> last_positions;
+    double log_gap_sum = 0.0;
+    for (size_t position = 0; position < document_order.size(); ++position)
+    {
+        for (const SearchServer::TermId term_id : search_server.GetDocumentTermIds(document_order[position]))
+        {
+            if (last_positions.size() <= term_id)
+            {
+                last_positions.resize(term_id + 1, 0);
+            }
+            const size_t gap = position + 1 - last_positions[term_id];
+            last_positions[term_id] = position + 1;
+            ++stats.postings;
+            stats.varint_bytes += VarintSize(gap);
+            log_gap_sum += std::log2(static_cast<double>(gap));
+        }
+    }
+    stats.average_log_gap = stats.postings == 0 ? 0.0 : log_gap_sum / stats.postings;
+    return stats;
+}
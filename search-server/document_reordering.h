@@ -0,0 +1,32 @@
+#pragma once
+#include "search_server.h"
+#include <vector>
+
+// Параметры перенумерации документов рекурсивной бисекцией графа (BP).
+// Документы делятся пополам так, чтобы слова документов скапливались в одной из половин,
+// затем каждая половина делится так же. В итоге документы с похожими словами получают
+// близкие номера, и разности соседних номеров в posting-листах уменьшаются
+struct BisectionOptions
+{
+    // Обменов между половинами на каждом уровне: больше — точнее и дольше
+    int iterations = 10;
+    // Части не больше этого размера не делятся
+    size_t min_partition_size = 16;
+};
+
+// Порядок документов для SearchServer::ReorderDocuments. Начальный порядок — текущие слоты.
+// Время O(iterations * (число записей индекса) * log(число документов))
+std::vector<int> ComputeBisectionOrder(const SearchServer &search_server);
+std::vector<int> ComputeBisectionOrder(const SearchServer &search_server, const BisectionOptions &options);
+
+// Сжимаемость posting-листов при нумерации документов по порядку document_order:
+// разности соседних номеров в каждом posting-листе в кодировке varint
+struct PostingGapStats
+{
+    size_t postings = 0;
+    size_t varint_bytes = 0;
+    // Среднее log2 разности: оценка числа бит на запись при хорошем кодировании
+    double average_log_gap = 0.0;
+};
+
+PostingGapStats MeasurePostingGaps(const SearchServer &search_server, const std::vector<int> &document_order);
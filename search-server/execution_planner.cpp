@@ -0,0 +1,81 @@
+#include "execution_planner.h"
+#include <tbb/info.h>
+#include <algorithm>
+
+ExecutionPlanner::ExecutionPlanner(const ExecutionPlanner &other)
+    : model_(other.model_)
+{
+}
+
+ExecutionPlanner &ExecutionPlanner::operator=(const ExecutionPlanner &other)
+{
+    if (this != &other)
+    {
+        model_ = other.model_;
+        ResetStats();
+    }
+    return *this;
+}
+
+void ExecutionPlanner::SetCostModel(const ExecutionCostModel &model)
+{
+    model_ = model;
+}
+
+const ExecutionCostModel &ExecutionPlanner::GetCostModel() const
+{
+    return model_;
+}
+
+ExecutionPlan ExecutionPlanner::Plan(size_t estimated_work) const
+{
+    ExecutionPlan plan;
+    plan.estimated_work = estimated_work;
+    const size_t max_concurrency = GetMaxConcurrency();
+    if (max_concurrency < 2 || estimated_work < model_.min_parallel_work)
+    {
+        return plan;
+    }
+    const size_t work_per_thread = std::max<size_t>(model_.work_per_thread, 1);
+    plan.parallel = true;
+    plan.concurrency = std::clamp<size_t>((estimated_work + work_per_thread - 1) / work_per_thread, 2, max_concurrency);
+    return plan;
+}
+
+ExecutionStats ExecutionPlanner::GetStats() const
+{
+    ExecutionStats stats;
+    stats.sequential = sequential_.load(std::memory_order_relaxed);
+    stats.parallel = parallel_.load(std::memory_order_relaxed);
+    stats.parallel_threads = parallel_threads_.load(std::memory_order_relaxed);
+    stats.estimated_work = estimated_work_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ExecutionPlanner::ResetStats()
+{
+    sequential_ = 0;
+    parallel_ = 0;
+    parallel_threads_ = 0;
+    estimated_work_ = 0;
+}
+
+size_t ExecutionPlanner::GetMaxConcurrency() const
+{
+    if (model_.max_concurrency != 0)
+    {
+        return model_.max_concurrency;
+    }
+    return static_cast<size_t>(tbb::info::default_concurrency());
+}
+
+tbb::task_arena &ExecutionPlanner::GetArena(size_t concurrency) const
+{
+    std::lock_guard guard(arenas_mutex_);
+    auto &arena = arenas_[concurrency];
+    if (!arena)
+    {
+        arena = std::make_unique<tbb::task_arena>(static_cast<int>(concurrency));
+    }
+    return *arena;
+}
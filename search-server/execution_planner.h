@@ -0,0 +1,114 @@
+#pragma once
+#include <tbb/task_arena.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace search_execution
+{
+    // Политика, при которой SearchServer сам выбирает seq или par и число потоков
+    // по оценке работы вызова (ExecutionCostModel). Имя auto занято ключевым словом
+    struct automatic_policy
+    {
+    };
+    inline constexpr automatic_policy automatic{};
+
+    template <typename ExecutionPolicy>
+    inline constexpr bool IS_AUTOMATIC = std::is_same_v<std::decay_t<ExecutionPolicy>, automatic_policy>;
+}
+
+// Работа измеряется в записях posting-листов; остальные операции переводятся в них
+// по своей цене (SearchServer)
+struct ExecutionCostModel
+{
+    // Меньше этого вызов выполняется последовательно: запуск вложенных задач TBB,
+    // атомарный словарь релевантности и слияние результатов обходятся дороже выигрыша
+    size_t min_parallel_work = 20'000;
+    // Работа на один поток: потоков берётся work / work_per_thread, не больше max_concurrency
+    size_t work_per_thread = 10'000;
+    // 0 — число потоков TBB по умолчанию
+    size_t max_concurrency = 0;
+};
+
+// Решение для одного вызова
+struct ExecutionPlan
+{
+    size_t estimated_work = 0;
+    bool parallel = false;
+    // 1 при последовательном выполнении
+    size_t concurrency = 1;
+};
+
+struct ExecutionStats
+{
+    uint64_t sequential = 0;
+    uint64_t parallel = 0;
+    // Сумма выбранного числа потоков по параллельным вызовам
+    uint64_t parallel_threads = 0;
+    uint64_t estimated_work = 0;
+};
+
+/**
+ * Выбор seq или par по оценке работы для search_execution::automatic. Параллельный вызов
+ * с числом потоков меньше максимального выполняется в отдельной арене TBB с таким пределом
+ * параллелизма; арены создаются при первом использовании и переиспользуются.
+ *
+ * Run и Plan можно вызывать из нескольких потоков; SetCostModel — только когда вызовов нет.
+ * Копия получает ту же модель, счётчики и арены у неё свои.
+ */
+class ExecutionPlanner
+{
+public:
+    ExecutionPlanner() = default;
+    ExecutionPlanner(const ExecutionPlanner &other);
+    ExecutionPlanner &operator=(const ExecutionPlanner &other);
+
+    void SetCostModel(const ExecutionCostModel &model);
+    const ExecutionCostModel &GetCostModel() const;
+    ExecutionPlan Plan(size_t estimated_work) const;
+    ExecutionStats GetStats() const;
+    void ResetStats();
+
+    // Вызывает function(std::execution::seq) или function(std::execution::par) по решению
+    // для estimated_work и учитывает решение в статистике
+    template <typename Function>
+    auto Run(size_t estimated_work, Function function) const;
+
+private:
+    ExecutionCostModel model_;
+    mutable std::atomic<uint64_t> sequential_ = 0;
+    mutable std::atomic<uint64_t> parallel_ = 0;
+    mutable std::atomic<uint64_t> parallel_threads_ = 0;
+    mutable std::atomic<uint64_t> estimated_work_ = 0;
+    mutable std::mutex arenas_mutex_;
+    mutable std::map<size_t, std::unique_ptr<tbb::task_arena>> arenas_;
+
+    size_t GetMaxConcurrency() const;
+    tbb::task_arena &GetArena(size_t concurrency) const;
+};
+
+template <typename Function>
+auto ExecutionPlanner::Run(size_t estimated_work, Function function) const
+{
+    const ExecutionPlan plan = Plan(estimated_work);
+    estimated_work_.fetch_add(estimated_work, std::memory_order_relaxed);
+    if (!plan.parallel)
+    {
+        sequential_.fetch_add(1, std::memory_order_relaxed);
+        return function(std::execution::seq);
+    }
+    parallel_.fetch_add(1, std::memory_order_relaxed);
+    parallel_threads_.fetch_add(plan.concurrency, std::memory_order_relaxed);
+    // Текущая арена (в том числе арена шарда ShardedSearchServer) уже не шире плана
+    if (plan.concurrency >= static_cast<size_t>(tbb::this_task_arena::max_concurrency()))
+    {
+        return function(std::execution::par);
+    }
+    return GetArena(plan.concurrency).execute([&function]
+                                              { return function(std::execution::par); });
+}
@@ -0,0 +1,633 @@
+// Генератор нагрузки на SearchServer: в этом процессе или через QueryServer.
+//
+// Запросы — GenerateQueries с --minus-prob; запрос номер i нагрузки — i-й по кругу.
+// Замкнутый цикл (--mode=closed): --connections соединений (или потоков для --target=in-process),
+// в каждом до --pipeline запросов без ответа; следующий уходит после ответа, так что
+// нагрузка подстраивается под сервер. Латентность — от отправки до ответа.
+// Открытый цикл (--mode=open): запросы приходят с фиксированной частотой --rate (можно
+// перечислить несколько через запятую — получится кривая латентности от нагрузки) в течение
+// --duration секунд, независимо от ответов. Латентность считается от запланированного
+// момента отправки, а не от фактического: запрос, задержанный занятым сервером или клиентом,
+// учитывает и ожидание (поправка на coordinated omission). Латентность от фактической
+// отправки выводится отдельно как .service.
+// Для каждого прогона выводятся пропускная способность и перцентили, в целом и по интервалам
+// --window-ms по времени завершения (.window.<номер>).
+//
+// С --target=server без --port поднимает QueryServer в этом же процессе на свободном порту
+// loopback. Если сервер был пуст, документы загружаются через сеть и выдача сверяется
+// с контрольным SearchServer. Отчёт — BenchmarkReport (TSV); код возврата 1, если выдача
+// разошлась или соединение оборвалось.
+//
+// Сборка (из каталога search-server/load_generator):
+//   g++ --std=c++17 -O2 -pthread main.cpp $(ls ../*.cpp | grep -v main.cpp) -o build/main -ltbb
+//
+// Пример:
+//   ./build/main --connections=8 --pipeline=16 --documents=20000
+//   ./build/main --target=in-process --mode=open --rate=200,400,800 --duration=10 --connections=8
+//   ../query_server/build/main --port=7000 &
+//   ./build/main --port=7000 --mode=open --rate=1000
+
+#include "../search_server.h"
+#include "../query_client.h"
+#include "../query_server.h"
+#include "../test_example_functions.h"
+#include "../benchmark_stats.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+struct LoadOptions
+{
+    // server или in-process
+    string target = "server"s;
+    // closed или open
+    string mode = "closed"s;
+    string address = "127.0.0.1"s;
+    // 0 — поднять сервер в этом процессе
+    int port = 0;
+    // Рабочие потоки встроенного сервера, 0 — по числу ядер
+    int workers = 0;
+    int connections = 4;
+    int pipeline = 8;
+    // Запросов в секунду для открытого цикла
+    vector<double> rates = {100.0};
+    double duration = 5.0;
+    int window_ms = 1'000;
+    int documents = 10'000;
+    int dictionary = 1'000;
+    int document_words = 70;
+    int queries = 10'000;
+    int query_words = 10;
+    double minus_prob = 0.1;
+    unsigned seed = mt19937::default_seed;
+    string stop_words;
+    string baseline;
+};
+
+LoadOptions ParseOptions(int argc, char **argv)
+{
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg = argv[i];
+        const auto eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos)
+        {
+            throw invalid_argument("Expected --name=value, got "s + string(arg));
+        }
+        const string_view name = arg.substr(2, eq - 2);
+        const string value(arg.substr(eq + 1));
+        if (name == "target"sv)
+        {
+            options.target = value;
+        }
+        else if (name == "mode"sv)
+        {
+            options.mode = value;
+        }
+        else if (name == "address"sv)
+        {
+            options.address = value;
+        }
+        else if (name == "port"sv)
+        {
+            options.port = stoi(value);
+        }
+        else if (name == "workers"sv)
+        {
+            options.workers = stoi(value);
+        }
+        else if (name == "connections"sv)
+        {
+            options.connections = stoi(value);
+        }
+        else if (name == "pipeline"sv)
+        {
+            options.pipeline = stoi(value);
+        }
+        else if (name == "rate"sv)
+        {
+            options.rates.clear();
+            for (string rates = value; !rates.empty();)
+            {
+                const size_t comma = min(rates.find(','), rates.size());
+                options.rates.push_back(stod(rates.substr(0, comma)));
+                rates.erase(0, comma + 1);
+            }
+        }
+        else if (name == "duration"sv)
+        {
+            options.duration = stod(value);
+        }
+        else if (name == "window-ms"sv)
+        {
+            options.window_ms = stoi(value);
+        }
+        else if (name == "documents"sv)
+        {
+            options.documents = stoi(value);
+        }
+        else if (name == "dictionary"sv)
+        {
+            options.dictionary = stoi(value);
+        }
+        else if (name == "document-words"sv)
+        {
+            options.document_words = stoi(value);
+        }
+        else if (name == "queries"sv)
+        {
+            options.queries = stoi(value);
+        }
+        else if (name == "query-words"sv)
+        {
+            options.query_words = stoi(value);
+        }
+        else if (name == "minus-prob"sv)
+        {
+            options.minus_prob = stod(value);
+        }
+        else if (name == "seed"sv)
+        {
+            options.seed = static_cast<unsigned>(stoul(value));
+        }
+        else if (name == "stop-words"sv)
+        {
+            options.stop_words = value;
+        }
+        else if (name == "baseline"sv)
+        {
+            options.baseline = value;
+        }
+        else
+        {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    if (options.target != "server"s && options.target != "in-process"s)
+    {
+        throw invalid_argument("Target must be server or in-process"s);
+    }
+    if (options.mode != "closed"s && options.mode != "open"s)
+    {
+        throw invalid_argument("Mode must be closed or open"s);
+    }
+    if (options.connections <= 0 || options.pipeline <= 0 || options.window_ms <= 0 || options.queries <= 0)
+    {
+        throw invalid_argument("Connections, pipeline depth, window and query count must be positive"s);
+    }
+    if (options.rates.empty() || any_of(options.rates.begin(), options.rates.end(), [](double rate)
+                                        { return rate <= 0.0; }))
+    {
+        throw invalid_argument("Rates must be positive"s);
+    }
+    return options;
+}
+
+// QueryServer в потоке этого процесса; останавливается при разрушении
+class EmbeddedServer
+{
+public:
+    EmbeddedServer(SearchServer &search_server, const QueryServerOptions &options)
+        : server_(search_server, options), thread_([this]
+                                                   { server_.Run(); })
+    {
+    }
+
+    ~EmbeddedServer()
+    {
+        Stop();
+    }
+
+    uint16_t GetPort() const
+    {
+        return server_.GetPort();
+    }
+
+    QueryServerStats Stop()
+    {
+        if (thread_.joinable())
+        {
+            server_.Stop();
+            thread_.join();
+        }
+        return server_.GetStats();
+    }
+
+private:
+    QueryServer server_;
+    thread thread_;
+};
+
+// Куда идут запросы: в search_server этого процесса, если он задан, иначе в QueryServer
+struct Target
+{
+    const SearchServer *search_server = nullptr;
+    string address;
+    uint16_t port = 0;
+};
+
+struct Workload
+{
+    const vector<string> &queries;
+    size_t request_count = 0;
+    // Выдача на первые queries.size() запросов: каждый из них выполняется ровно один раз
+    vector<optional<vector<Document>>> &results;
+
+    const string &GetQuery(size_t request) const
+    {
+        return queries[request % queries.size()];
+    }
+
+    void SetResult(size_t request, vector<Document> documents) const
+    {
+        if (request < results.size())
+        {
+            results[request] = move(documents);
+        }
+    }
+};
+
+struct RunResult
+{
+    // Латентность от отправки (замкнутый цикл) или от запланированного момента (открытый)
+    vector<TimedSample> samples;
+    // Открытый цикл: латентность от фактической отправки
+    vector<double> service_latencies;
+    double seconds = 0.0;
+    bool failed = false;
+};
+
+double MicrosecondsBetween(Clock::time_point from, Clock::time_point to)
+{
+    return chrono::duration<double, micro>(to - from).count();
+}
+
+// Запускает thread_count потоков run_thread(номер потока, RunResult потока) и сливает их замеры
+template <typename RunThread>
+RunResult RunThreads(int thread_count, RunThread run_thread)
+{
+    vector<RunResult> thread_results(thread_count);
+    vector<thread> threads;
+    const auto start = Clock::now();
+    for (int i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&run_thread, &thread_results, i]
+                             {
+                                 try
+                                 {
+                                     run_thread(i, thread_results[i]);
+                                 }
+                                 catch (const exception &e)
+                                 {
+                                     cerr << e.what() << endl;
+                                     thread_results[i].failed = true;
+                                 } });
+    }
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+
+    RunResult result;
+    result.seconds = MicrosecondsBetween(start, Clock::now()) / 1e6;
+    for (RunResult &thread_result : thread_results)
+    {
+        result.samples.insert(result.samples.end(), thread_result.samples.begin(), thread_result.samples.end());
+        result.service_latencies.insert(result.service_latencies.end(), thread_result.service_latencies.begin(), thread_result.service_latencies.end());
+        result.failed = result.failed || thread_result.failed;
+    }
+    return result;
+}
+
+RunResult RunClosedLoop(const Target &target, const Workload &workload, int concurrency, int pipeline)
+{
+    atomic_size_t next_request = 0;
+    const auto start = Clock::now();
+    return RunThreads(concurrency, [&](int, RunResult &result)
+                      {
+                          if (target.search_server)
+                          {
+                              for (size_t request = next_request++; request < workload.request_count; request = next_request++)
+                              {
+                                  const auto sent = Clock::now();
+                                  auto documents = target.search_server->FindTopDocuments(workload.GetQuery(request));
+                                  const auto done = Clock::now();
+                                  result.samples.push_back({MicrosecondsBetween(start, done), MicrosecondsBetween(sent, done)});
+                                  workload.SetResult(request, move(documents));
+                              }
+                              return;
+                          }
+
+                          QueryClient client(target.address, target.port);
+                          deque<pair<size_t, Clock::time_point>> in_flight;
+                          while (true)
+                          {
+                              while (in_flight.size() < static_cast<size_t>(pipeline))
+                              {
+                                  const size_t request = next_request++;
+                                  if (request >= workload.request_count)
+                                  {
+                                      break;
+                                  }
+                                  in_flight.emplace_back(request, Clock::now());
+                                  client.SendFindTopDocuments(workload.GetQuery(request));
+                              }
+                              if (in_flight.empty())
+                              {
+                                  return;
+                              }
+                              const auto [request, sent] = in_flight.front();
+                              in_flight.pop_front();
+                              auto documents = client.ReceiveFindTopDocuments();
+                              const auto done = Clock::now();
+                              result.samples.push_back({MicrosecondsBetween(start, done), MicrosecondsBetween(sent, done)});
+                              workload.SetResult(request, move(documents));
+                          } });
+}
+
+RunResult RunOpenLoop(const Target &target, const Workload &workload, int concurrency, double rate)
+{
+    // Запас на запуск потоков, чтобы первые запросы не опаздывали из-за него
+    const auto start = Clock::now() + 10ms;
+    const auto scheduled = [start, rate](size_t request)
+    {
+        return start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(request / rate));
+    };
+
+    if (target.search_server)
+    {
+        // Поток берёт следующий по расписанию запрос; если все потоки заняты, запрос ждёт,
+        // и ожидание входит в его латентность
+        atomic_size_t next_request = 0;
+        return RunThreads(concurrency, [&](int, RunResult &result)
+                          {
+                              for (size_t request = next_request++; request < workload.request_count; request = next_request++)
+                              {
+                                  const auto planned = scheduled(request);
+                                  this_thread::sleep_until(planned);
+                                  const auto sent = Clock::now();
+                                  auto documents = target.search_server->FindTopDocuments(workload.GetQuery(request));
+                                  const auto done = Clock::now();
+                                  result.samples.push_back({MicrosecondsBetween(start, done), MicrosecondsBetween(planned, done)});
+                                  result.service_latencies.push_back(MicrosecondsBetween(sent, done));
+                                  workload.SetResult(request, move(documents));
+                              } });
+    }
+
+    // Соединение c получает запросы c, c + concurrency, ...: отправитель шлёт их по расписанию,
+    // не дожидаясь ответов, а читатель в своём потоке забирает ответы по порядку
+    return RunThreads(concurrency, [&](int connection, RunResult &result)
+                      {
+                          QueryClient client(target.address, target.port);
+                          mutex in_flight_mutex;
+                          condition_variable in_flight_ready;
+                          deque<Clock::time_point> in_flight;
+                          bool sender_done = false;
+                          bool sender_failed = false;
+                          thread sender([&]
+                                        {
+                                            bool failed = false;
+                                            try
+                                            {
+                                                for (size_t request = connection; request < workload.request_count; request += concurrency)
+                                                {
+                                                    this_thread::sleep_until(scheduled(request));
+                                                    {
+                                                        lock_guard guard(in_flight_mutex);
+                                                        in_flight.push_back(Clock::now());
+                                                    }
+                                                    in_flight_ready.notify_one();
+                                                    client.SendFindTopDocuments(workload.GetQuery(request));
+                                                }
+                                            }
+                                            catch (const exception &e)
+                                            {
+                                                cerr << e.what() << endl;
+                                                failed = true;
+                                            }
+                                            lock_guard guard(in_flight_mutex);
+                                            sender_done = true;
+                                            sender_failed = failed;
+                                            in_flight_ready.notify_one(); });
+
+                          try
+                          {
+                              for (size_t request = connection; request < workload.request_count; request += concurrency)
+                              {
+                                  Clock::time_point sent;
+                                  {
+                                      unique_lock lock(in_flight_mutex);
+                                      in_flight_ready.wait(lock, [&]
+                                                           { return !in_flight.empty() || sender_done; });
+                                      if (in_flight.empty())
+                                      {
+                                          break;
+                                      }
+                                      sent = in_flight.front();
+                                      in_flight.pop_front();
+                                  }
+                                  auto documents = client.ReceiveFindTopDocuments();
+                                  const auto done = Clock::now();
+                                  result.samples.push_back({MicrosecondsBetween(start, done), MicrosecondsBetween(scheduled(request), done)});
+                                  result.service_latencies.push_back(MicrosecondsBetween(sent, done));
+                                  workload.SetResult(request, move(documents));
+                              }
+                          }
+                          catch (const exception &e)
+                          {
+                              cerr << e.what() << endl;
+                              result.failed = true;
+                          }
+                          sender.join();
+                          result.failed = result.failed || sender_failed; });
+}
+
+void ReportRun(BenchmarkReport &report, const string &prefix, const RunResult &run, int window_ms)
+{
+    report.Add(prefix + ".throughput"s, run.samples.size() / run.seconds, "queries/s");
+    vector<double> latencies;
+    for (const TimedSample &sample : run.samples)
+    {
+        latencies.push_back(sample.latency_us);
+    }
+    report.AddLatency(prefix, Summarize(move(latencies)));
+    if (!run.service_latencies.empty())
+    {
+        report.AddLatency(prefix + ".service"s, Summarize(run.service_latencies));
+    }
+    const auto windows = SummarizeWindows(run.samples, window_ms * 1000.0);
+    for (size_t i = 0; i < windows.size(); ++i)
+    {
+        const string name = prefix + ".window."s + to_string(i);
+        report.Add(name + ".throughput"s, windows[i].count / (window_ms / 1000.0), "queries/s");
+        report.Add(name + ".p50"s, windows[i].p50, "us");
+        report.Add(name + ".p99"s, windows[i].p99, "us");
+        report.Add(name + ".p999"s, windows[i].p999, "us");
+    }
+}
+
+bool SameDocuments(const vector<Document> &lhs, const vector<Document> &rhs)
+{
+    if (lhs.size() != rhs.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i)
+    {
+        if (lhs[i].id != rhs[i].id || abs(lhs[i].relevance - rhs[i].relevance) > EPSILON || lhs[i].rating != rhs[i].rating)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    LoadOptions options;
+    try
+    {
+        options = ParseOptions(argc, argv);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    const bool in_process = options.target == "in-process"s;
+    BenchmarkReport report;
+    report.AddParameter("target"sv, in_process ? options.target : options.port == 0 ? "embedded server"s : options.address + ":"s + to_string(options.port));
+    report.AddParameter("mode"sv, options.mode);
+    report.AddParameter("connections"sv, to_string(options.connections));
+    if (options.mode == "closed"s)
+    {
+        report.AddParameter("pipeline"sv, to_string(options.pipeline));
+    }
+    else
+    {
+        string rates;
+        for (const double rate : options.rates)
+        {
+            rates += (rates.empty() ? ""s : ","s) + to_string(static_cast<long long>(rate));
+        }
+        report.AddParameter("rates"sv, rates);
+        report.AddParameter("duration"sv, to_string(options.duration));
+    }
+    report.AddParameter("documents"sv, to_string(options.documents));
+    report.AddParameter("queries"sv, to_string(options.queries));
+    report.AddParameter("query_words"sv, to_string(options.query_words));
+    report.AddParameter("minus_prob"sv, to_string(options.minus_prob));
+    report.AddParameter("seed"sv, to_string(options.seed));
+    if (!options.baseline.empty() && !report.LoadBaseline(options.baseline))
+    {
+        cerr << "Cannot read baseline "s << options.baseline << endl;
+        return 1;
+    }
+
+    mt19937 generator(options.seed);
+    const auto dictionary = GenerateDictionary(generator, options.dictionary, 10);
+    const auto documents = GenerateQueries(generator, dictionary, options.documents, options.document_words);
+    const auto queries = GenerateQueries(generator, dictionary, options.queries, options.query_words, options.minus_prob);
+
+    try
+    {
+        SearchServer reference(options.stop_words);
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            reference.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+        }
+
+        Target target;
+        SearchServer embedded(options.stop_words);
+        unique_ptr<EmbeddedServer> server;
+        bool verify = false;
+        if (in_process)
+        {
+            target.search_server = &reference;
+        }
+        else
+        {
+            if (options.port == 0)
+            {
+                QueryServerOptions server_options;
+                server_options.worker_count = options.workers;
+                server = make_unique<EmbeddedServer>(embedded, server_options);
+                options.port = server->GetPort();
+            }
+            target.address = options.address;
+            target.port = static_cast<uint16_t>(options.port);
+
+            QueryClient loader(target.address, target.port);
+            const int initial_count = loader.GetDocumentCount();
+            const double add_us = MeasureMicroseconds([&]
+                                                      {
+                                                          for (size_t i = 0; i < documents.size(); ++i)
+                                                          {
+                                                              loader.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+                                                          } });
+            if (!documents.empty())
+            {
+                report.Add("add.throughput"sv, documents.size() / (add_us / 1e6), "docs/s");
+            }
+            // Сверять есть с чем, только если сервер был пуст
+            verify = initial_count == 0 && loader.GetDocumentCount() == reference.GetDocumentCount();
+        }
+
+        vector<optional<vector<Document>>> results(queries.size());
+        bool failed = false;
+        if (options.mode == "closed"s)
+        {
+            const RunResult run = RunClosedLoop(target, {queries, queries.size(), results}, options.connections, options.pipeline);
+            ReportRun(report, "find_top.closed"s, run, options.window_ms);
+            failed = run.failed;
+        }
+        else
+        {
+            for (const double rate : options.rates)
+            {
+                const size_t request_count = max<size_t>(1, static_cast<size_t>(rate * options.duration));
+                const RunResult run = RunOpenLoop(target, {queries, request_count, results}, options.connections, rate);
+                ReportRun(report, "find_top.open_"s + to_string(static_cast<long long>(rate)), run, options.window_ms);
+                failed = failed || run.failed;
+            }
+        }
+
+        size_t mismatches = 0;
+        if (verify)
+        {
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                mismatches += results[i] && !SameDocuments(*results[i], reference.FindTopDocuments(queries[i]));
+            }
+            report.Add("find_top.mismatches"sv, mismatches, "queries");
+        }
+
+        if (server)
+        {
+            const QueryServerStats stats = server->Stop();
+            report.Add("server.requests"sv, stats.requests, "requests");
+            report.Add("server.paused_reads"sv, stats.paused_reads, "times");
+        }
+        report.Print(cout);
+        return mismatches == 0 && !failed ? 0 : 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
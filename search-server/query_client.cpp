@@ -0,0 +1,137 @@
+#include "query_client.h"
+#include "query_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace query_protocol;
+
+QueryClient::QueryClient(const std::string &address, uint16_t port)
+{
+    using std::string_literals::operator""s;
+
+    sockaddr_in server_address{};
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &server_address.sin_addr) != 1)
+    {
+        throw std::invalid_argument("Invalid IPv4 address "s + address);
+    }
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0 || connect(fd_, reinterpret_cast<const sockaddr *>(&server_address), sizeof(server_address)) < 0)
+    {
+        const int error = errno;
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+        throw std::runtime_error("Cannot connect to "s + address + ":"s + std::to_string(port) + ": "s + std::strerror(error));
+    }
+    const int no_delay = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+}
+
+QueryClient::~QueryClient()
+{
+    close(fd_);
+}
+
+void QueryClient::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::ADD_DOCUMENT));
+    request.PutI32(document_id);
+    request.PutString(document);
+    request.PutU8(static_cast<uint8_t>(status));
+    request.PutU32(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings)
+    {
+        request.PutI32(rating);
+    }
+    Send(request.GetData());
+    Receive();
+}
+
+void QueryClient::RemoveDocument(int document_id)
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::REMOVE_DOCUMENT));
+    request.PutI32(document_id);
+    Send(request.GetData());
+    Receive();
+}
+
+std::vector<Document> QueryClient::FindTopDocuments(std::string_view raw_query, DocumentStatus status)
+{
+    SendFindTopDocuments(raw_query, status);
+    return ReceiveFindTopDocuments();
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> QueryClient::MatchDocument(std::string_view raw_query, int document_id)
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::MATCH_DOCUMENT));
+    request.PutString(raw_query);
+    request.PutI32(document_id);
+    Send(request.GetData());
+    MessageReader response = Receive();
+    const auto status = static_cast<DocumentStatus>(response.GetU8());
+    std::vector<std::string> words;
+    for (uint32_t count = response.GetU32(); count > 0; --count)
+    {
+        words.push_back(response.GetString());
+    }
+    return {words, status};
+}
+
+int QueryClient::GetDocumentCount()
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::DOCUMENT_COUNT));
+    Send(request.GetData());
+    MessageReader response = Receive();
+    return static_cast<int>(response.GetU32());
+}
+
+void QueryClient::SendFindTopDocuments(std::string_view raw_query, DocumentStatus status)
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::FIND_TOP));
+    request.PutString(raw_query);
+    request.PutU8(static_cast<uint8_t>(status));
+    Send(request.GetData());
+}
+
+std::vector<Document> QueryClient::ReceiveFindTopDocuments()
+{
+    MessageReader response = Receive();
+    return ReadDocuments(response);
+}
+
+void QueryClient::Send(const std::vector<char> &request)
+{
+    using std::string_literals::operator""s;
+
+    if (!shard_protocol::SendFrame(fd_, request))
+    {
+        throw std::runtime_error("Connection to query server is lost"s);
+    }
+}
+
+MessageReader QueryClient::Receive()
+{
+    using std::string_literals::operator""s;
+
+    if (!shard_protocol::ReceiveFrame(fd_, response_))
+    {
+        throw std::runtime_error("Connection to query server is lost"s);
+    }
+    MessageReader response(response_);
+    CheckResponse(response);
+    return response;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "document.h"
+#include "shard_protocol.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+/**
+ * Блокирующий клиент QueryServer по TCP (протокол — query_protocol.h).
+ * Ошибки запроса на сервере бросаются как invalid_argument или out_of_range,
+ * разрыв соединения — runtime_error.
+ *
+ * SendFindTopDocuments отправляет запрос, не дожидаясь ответа, а ReceiveFindTopDocuments
+ * читает ответ на самый ранний из неотвеченных: так в соединении держится несколько
+ * запросов сразу; отправлять и читать можно из двух разных потоков. Остальные методы
+ * ждут свой ответ и вызываются, когда неотвеченных запросов нет.
+ */
+class QueryClient
+{
+public:
+    QueryClient(const std::string &address, uint16_t port);
+    ~QueryClient();
+    QueryClient(const QueryClient &) = delete;
+    QueryClient &operator=(const QueryClient &) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+    void RemoveDocument(int document_id);
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id);
+    int GetDocumentCount();
+
+    void SendFindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+    std::vector<Document> ReceiveFindTopDocuments();
+
+private:
+    int fd_ = -1;
+    std::vector<char> response_;
+
+    void Send(const std::vector<char> &request);
+    // Читает кадр ответа в response_ и проверяет код ответа; возвращённый reader
+    // указывает на данные ответа
+    shard_protocol::MessageReader Receive();
+};
@@ -0,0 +1,148 @@
+#include "query_log.h"
+#include "concurrent_map.h"
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+    const std::string_view QUERY_LOG_MAGIC = "SQLG";
+    constexpr char QUERY_LOG_VERSION = 1;
+
+    void PutVarint(std::string &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    // false — данные кончились посреди числа
+    bool GetVarint(const std::string &data, size_t &position, uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; position < data.size() && shift < 64; shift += 7)
+        {
+            const auto byte = static_cast<unsigned char>(data[position++]);
+            value |= uint64_t{byte & 0x7fu} << shift;
+            if (byte < 0x80)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t ZigZag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t UnZigZag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+}
+
+uint64_t ResultChecksum(const std::vector<Document> &documents)
+{
+    uint64_t checksum = documents.size();
+    for (const Document &document : documents)
+    {
+        checksum = MixKey(checksum ^ static_cast<uint32_t>(document.id));
+        checksum = MixKey(checksum ^ static_cast<uint32_t>(document.rating));
+    }
+    return checksum;
+}
+
+QueryLogWriter::QueryLogWriter(const std::string &path)
+    : out_(path, std::ios::binary | std::ios::trunc)
+{
+    using std::string_literals::operator""s;
+
+    if (!out_)
+    {
+        throw std::runtime_error("Cannot open query log "s + path);
+    }
+    out_.write(QUERY_LOG_MAGIC.data(), QUERY_LOG_MAGIC.size());
+    out_.put(QUERY_LOG_VERSION);
+}
+
+void QueryLogWriter::Append(std::string_view raw_query, QueryFilter filter, const std::vector<Document> &result,
+                            std::chrono::system_clock::time_point time)
+{
+    const int64_t timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    const uint64_t checksum = ResultChecksum(result);
+
+    std::lock_guard guard(mutex_);
+    std::string record;
+    PutVarint(record, ZigZag(timestamp_us - last_timestamp_us_));
+    record.push_back(static_cast<char>(static_cast<uint8_t>(filter.kind) << 4 | static_cast<uint8_t>(filter.status)));
+    PutVarint(record, raw_query.size());
+    record.append(raw_query);
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        record.push_back(static_cast<char>(checksum >> shift & 0xff));
+    }
+    out_.write(record.data(), record.size());
+    last_timestamp_us_ = timestamp_us;
+}
+
+void QueryLogWriter::Flush()
+{
+    std::lock_guard guard(mutex_);
+    out_.flush();
+}
+
+std::vector<QueryLogRecord> ReadQueryLog(const std::string &path)
+{
+    using std::string_literals::operator""s;
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Cannot open query log "s + path);
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < QUERY_LOG_MAGIC.size() + 1 || data.compare(0, QUERY_LOG_MAGIC.size(), QUERY_LOG_MAGIC) != 0 ||
+        data[QUERY_LOG_MAGIC.size()] != QUERY_LOG_VERSION)
+    {
+        throw std::runtime_error(path + " is not a query log"s);
+    }
+
+    std::vector<QueryLogRecord> records;
+    int64_t timestamp_us = 0;
+    size_t position = QUERY_LOG_MAGIC.size() + 1;
+    while (position < data.size())
+    {
+        QueryLogRecord record;
+        uint64_t delta = 0;
+        uint64_t size = 0;
+        if (!GetVarint(data, position, delta) || position == data.size())
+        {
+            break;
+        }
+        const auto filter = static_cast<uint8_t>(data[position++]);
+        if (!GetVarint(data, position, size) || data.size() - position < size + 8)
+        {
+            break;
+        }
+        if ((filter >> 4) > static_cast<uint8_t>(QueryFilterKind::PREDICATE) ||
+            (filter & 0xf) > static_cast<uint8_t>(DocumentStatus::REMOVED))
+        {
+            throw std::runtime_error("Corrupted query log "s + path);
+        }
+        timestamp_us += UnZigZag(delta);
+        record.timestamp_us = timestamp_us;
+        record.filter = {static_cast<QueryFilterKind>(filter >> 4), static_cast<DocumentStatus>(filter & 0xf)};
+        record.raw_query = data.substr(position, size);
+        position += size;
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            record.result_checksum |= uint64_t{static_cast<unsigned char>(data[position++])} << shift;
+        }
+        records.push_back(std::move(record));
+    }
+    return records;
+}
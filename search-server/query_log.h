@@ -0,0 +1,67 @@
+#pragma once
+#include "document.h"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Фильтр записанного запроса. Произвольный предикат в журнал не сохранить:
+// такой запрос записывается как PREDICATE и воспроизводится без фильтра (ACTUAL)
+enum class QueryFilterKind : uint8_t
+{
+    STATUS = 0,
+    PREDICATE,
+};
+
+struct QueryFilter
+{
+    QueryFilterKind kind = QueryFilterKind::STATUS;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+};
+
+struct QueryLogRecord
+{
+    // Микросекунды от эпохи system_clock
+    int64_t timestamp_us = 0;
+    std::string raw_query;
+    QueryFilter filter;
+    // ResultChecksum выдачи в момент записи
+    uint64_t result_checksum = 0;
+};
+
+// Хэш id и рейтингов выдачи в её порядке. Релевантность не входит: её последние биты
+// зависят от порядка суммирования и различаются между seq и par
+uint64_t ResultChecksum(const std::vector<Document> &documents);
+
+/**
+ * Журнал запросов для воспроизведения нагрузки (query_replay). Формат: заголовок
+ * "SQLG" и версия (1 байт), затем записи подряд: разность времени с предыдущей записью
+ * в микросекундах (zigzag varint), байт фильтра (вид << 4 | статус), длина запроса (varint),
+ * байты запроса и контрольная сумма выдачи (8 байт little-endian).
+ * Служебная часть записи — 11-14 байт на запрос.
+ *
+ * Append можно вызывать из нескольких потоков. Запись буферизуется; Flush и деструктор
+ * сбрасывают буфер в файл.
+ */
+class QueryLogWriter
+{
+public:
+    // Создаёт или перезаписывает файл; бросает std::runtime_error
+    explicit QueryLogWriter(const std::string &path);
+
+    void Append(std::string_view raw_query, QueryFilter filter, const std::vector<Document> &result,
+                std::chrono::system_clock::time_point time = std::chrono::system_clock::now());
+    void Flush();
+
+private:
+    std::mutex mutex_;
+    std::ofstream out_;
+    int64_t last_timestamp_us_ = 0;
+};
+
+// Читает журнал целиком. Незаконченная последняя запись (процесс прервался во время записи)
+// отбрасывается; неверный заголовок или повреждённая запись — std::runtime_error
+std::vector<QueryLogRecord> ReadQueryLog(const std::string &path);
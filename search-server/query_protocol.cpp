@@ -0,0 +1,49 @@
+#include "query_protocol.h"
+#include <stdexcept>
+
+namespace query_protocol
+{
+    void WriteDocuments(MessageWriter &message, const std::vector<Document> &documents)
+    {
+        message.PutU32(static_cast<uint32_t>(documents.size()));
+        for (const Document &document : documents)
+        {
+            message.PutI32(document.id);
+            message.PutDouble(document.relevance);
+            message.PutI32(document.rating);
+        }
+    }
+
+    std::vector<Document> ReadDocuments(MessageReader &message)
+    {
+        std::vector<Document> documents;
+        for (uint32_t count = message.GetU32(); count > 0; --count)
+        {
+            const int document_id = message.GetI32();
+            const double relevance = message.GetDouble();
+            documents.emplace_back(document_id, relevance, message.GetI32());
+        }
+        return documents;
+    }
+
+    void CheckResponse(MessageReader &message)
+    {
+        using std::string_literals::operator""s;
+
+        const auto code = static_cast<ResponseCode>(message.GetU8());
+        if (code == ResponseCode::OK)
+        {
+            return;
+        }
+        const std::string text = message.GetString();
+        switch (code)
+        {
+        case ResponseCode::INVALID_ARGUMENT:
+            throw std::invalid_argument(text);
+        case ResponseCode::OUT_OF_RANGE:
+            throw std::out_of_range(text);
+        default:
+            throw std::runtime_error("Server error: "s + text);
+        }
+    }
+}
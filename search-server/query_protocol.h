@@ -0,0 +1,42 @@
+#pragma once
+#include "document.h"
+#include "shard_protocol.h"
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * Протокол сетевого фронтенда SearchServer (QueryServer, QueryClient) поверх TCP.
+ * Кадры и кодирование те же, что в shard_protocol.h: длина тела (uint32) и тело,
+ * тело запроса начинается с RequestType, тело ответа — с ResponseCode.
+ * Клиент может отправлять запросы, не дожидаясь ответов (конвейер): запросы одного
+ * соединения выполняются по очереди, и ответы приходят в том же порядке.
+ */
+namespace query_protocol
+{
+    using shard_protocol::MessageReader;
+    using shard_protocol::MessageWriter;
+    using shard_protocol::ResponseCode;
+
+    enum class RequestType : uint8_t
+    {
+        // id, текст, статус, рейтинги -> пусто
+        ADD_DOCUMENT = 1,
+        // id -> пусто
+        REMOVE_DOCUMENT,
+        // запрос, статус -> тройки (id, релевантность, рейтинг)
+        FIND_TOP,
+        // запрос, id -> статус, слова
+        MATCH_DOCUMENT,
+        // -> число документов
+        DOCUMENT_COUNT,
+    };
+
+    void WriteDocuments(MessageWriter &message, const std::vector<Document> &documents);
+    std::vector<Document> ReadDocuments(MessageReader &message);
+
+    // Проверяет код ответа: ошибки сервера бросаются как invalid_argument, out_of_range
+    // или runtime_error; после вызова message указывает на данные ответа
+    void CheckResponse(MessageReader &message);
+}
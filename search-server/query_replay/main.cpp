@@ -0,0 +1,372 @@
+// Запись и воспроизведение журнала запросов (query_log.h).
+//
+// С --record=<путь> гоняет --queries запросов через RequestQueue с QueryLogWriter: слова
+// запросов берутся по закону Ципфа (--zipf), а не равновероятно, интервалы между запросами
+// экспоненциальные со средней частотой --rate. Так получается журнал для проверки инструмента;
+// в работе журнал пишет RequestQueue настоящего сервиса.
+//
+// Без --record воспроизводит журнал --log на снимке коллекции: документах из --documents-file
+// (строки "id<TAB>рейтинг<TAB>текст") или сгенерированных с тем же --seed, что при записи.
+// --speed=1 — в исходном темпе, --speed=N — в N раз быстрее, --speed=0 — как можно быстрее;
+// запросы выполняют --threads потоков. При воспроизведении в темпе латентность считается
+// от запланированного момента (ожидание свободного потока входит в неё), от фактического
+// начала — отдельно как .service.
+// Отчёт — BenchmarkReport (TSV): пропускная способность, латентность, общая контрольная сумма
+// выдачи и число запросов, чья выдача разошлась с записанной (запросы с произвольным
+// предикатом не сверяются). Код возврата 1, если выдача разошлась.
+//
+// Сборка (из каталога search-server/query_replay):
+//   g++ --std=c++17 -O2 -pthread main.cpp $(ls ../*.cpp | grep -v main.cpp) -o build/main -ltbb
+//
+// Пример:
+//   ./build/main --record=queries.log --queries=20000 --rate=2000
+//   ./build/main --log=queries.log --speed=0 --threads=8
+//   ./build/main --log=queries.log --speed=4 --threads=8 --baseline=baseline.tsv
+
+#include "../search_server.h"
+#include "../request_queue.h"
+#include "../query_log.h"
+#include "../test_example_functions.h"
+#include "../benchmark_stats.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+struct ReplayOptions
+{
+    string record;
+    string log;
+    string documents_file;
+    double speed = 1.0;
+    int threads = 4;
+    int documents = 10'000;
+    int dictionary = 1'000;
+    int document_words = 70;
+    // Для --record
+    int queries = 10'000;
+    int query_words = 10;
+    double minus_prob = 0.1;
+    double zipf = 1.0;
+    double rate = 1'000.0;
+    unsigned seed = mt19937::default_seed;
+    string stop_words;
+    string baseline;
+};
+
+ReplayOptions ParseOptions(int argc, char **argv)
+{
+    ReplayOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg = argv[i];
+        const auto eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos)
+        {
+            throw invalid_argument("Expected --name=value, got "s + string(arg));
+        }
+        const string_view name = arg.substr(2, eq - 2);
+        const string value(arg.substr(eq + 1));
+        if (name == "record"sv)
+        {
+            options.record = value;
+        }
+        else if (name == "log"sv)
+        {
+            options.log = value;
+        }
+        else if (name == "documents-file"sv)
+        {
+            options.documents_file = value;
+        }
+        else if (name == "speed"sv)
+        {
+            options.speed = stod(value);
+        }
+        else if (name == "threads"sv)
+        {
+            options.threads = stoi(value);
+        }
+        else if (name == "documents"sv)
+        {
+            options.documents = stoi(value);
+        }
+        else if (name == "dictionary"sv)
+        {
+            options.dictionary = stoi(value);
+        }
+        else if (name == "document-words"sv)
+        {
+            options.document_words = stoi(value);
+        }
+        else if (name == "queries"sv)
+        {
+            options.queries = stoi(value);
+        }
+        else if (name == "query-words"sv)
+        {
+            options.query_words = stoi(value);
+        }
+        else if (name == "minus-prob"sv)
+        {
+            options.minus_prob = stod(value);
+        }
+        else if (name == "zipf"sv)
+        {
+            options.zipf = stod(value);
+        }
+        else if (name == "rate"sv)
+        {
+            options.rate = stod(value);
+        }
+        else if (name == "seed"sv)
+        {
+            options.seed = static_cast<unsigned>(stoul(value));
+        }
+        else if (name == "stop-words"sv)
+        {
+            options.stop_words = value;
+        }
+        else if (name == "baseline"sv)
+        {
+            options.baseline = value;
+        }
+        else
+        {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    if (options.record.empty() == options.log.empty())
+    {
+        throw invalid_argument("Exactly one of --record and --log is required"s);
+    }
+    if (options.threads <= 0 || options.speed < 0.0 || options.rate <= 0.0)
+    {
+        throw invalid_argument("Threads and rate must be positive, speed must not be negative"s);
+    }
+    return options;
+}
+
+// Снимок коллекции: из файла или сгенерированный, как в остальных инструментах
+void LoadDocuments(SearchServer &search_server, const ReplayOptions &options, mt19937 &generator, const vector<string> &dictionary)
+{
+    if (options.documents_file.empty())
+    {
+        const auto documents = GenerateQueries(generator, dictionary, options.documents, options.document_words);
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+        }
+        return;
+    }
+    ifstream in(options.documents_file);
+    if (!in)
+    {
+        throw runtime_error("Cannot open "s + options.documents_file);
+    }
+    string line;
+    while (getline(in, line))
+    {
+        const size_t first_tab = line.find('\t');
+        const size_t second_tab = line.find('\t', first_tab + 1);
+        if (first_tab == line.npos || second_tab == line.npos)
+        {
+            throw invalid_argument("Expected id<TAB>rating<TAB>text, got "s + line);
+        }
+        search_server.AddDocument(stoi(line.substr(0, first_tab)), string_view(line).substr(second_tab + 1),
+                                  DocumentStatus::ACTUAL, {stoi(line.substr(first_tab + 1, second_tab - first_tab - 1))});
+    }
+}
+
+// Запрос из слов с вероятностями по закону Ципфа: слово ранга r выбирается с вероятностью ~ 1 / r^zipf
+string GenerateSkewedQuery(mt19937 &generator, const vector<string> &dictionary, discrete_distribution<size_t> &word_rank, int word_count, double minus_prob)
+{
+    string query;
+    for (int i = 0; i < word_count; ++i)
+    {
+        if (!query.empty())
+        {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob)
+        {
+            query.push_back('-');
+        }
+        query += dictionary[word_rank(generator)];
+    }
+    return query;
+}
+
+int Record(const ReplayOptions &options)
+{
+    mt19937 generator(options.seed);
+    const auto dictionary = GenerateDictionary(generator, options.dictionary, 10);
+    SearchServer search_server(options.stop_words);
+    LoadDocuments(search_server, options, generator, dictionary);
+
+    vector<double> weights(dictionary.size());
+    for (size_t rank = 0; rank < weights.size(); ++rank)
+    {
+        weights[rank] = 1.0 / pow(rank + 1.0, options.zipf);
+    }
+    discrete_distribution<size_t> word_rank(weights.begin(), weights.end());
+    exponential_distribution<double> interval(options.rate);
+
+    QueryLogWriter query_log(options.record);
+    RequestQueue request_queue(search_server, query_log);
+    auto next = Clock::now();
+    for (int i = 0; i < options.queries; ++i)
+    {
+        const string query = GenerateSkewedQuery(generator, dictionary, word_rank, options.query_words, options.minus_prob);
+        next += chrono::duration_cast<Clock::duration>(chrono::duration<double>(interval(generator)));
+        this_thread::sleep_until(next);
+        // Каждый десятый запрос — по документам со статусом BANNED, чтобы в журнале были фильтры
+        if (i % 10 == 9)
+        {
+            request_queue.AddFindRequest(query, DocumentStatus::BANNED);
+        }
+        else
+        {
+            request_queue.AddFindRequest(query);
+        }
+    }
+    query_log.Flush();
+    cerr << "Recorded "s << options.queries << " queries to "s << options.record << endl;
+    return 0;
+}
+
+int Replay(const ReplayOptions &options)
+{
+    BenchmarkReport report;
+    report.AddParameter("log"sv, options.log);
+    report.AddParameter("speed"sv, to_string(options.speed));
+    report.AddParameter("threads"sv, to_string(options.threads));
+    report.AddParameter("snapshot"sv, options.documents_file.empty() ? "generated, "s + to_string(options.documents) + " documents"s : options.documents_file);
+    report.AddParameter("seed"sv, to_string(options.seed));
+    if (!options.baseline.empty() && !report.LoadBaseline(options.baseline))
+    {
+        cerr << "Cannot read baseline "s << options.baseline << endl;
+        return 1;
+    }
+
+    const vector<QueryLogRecord> records = ReadQueryLog(options.log);
+    mt19937 generator(options.seed);
+    const auto dictionary = GenerateDictionary(generator, options.dictionary, 10);
+    SearchServer search_server(options.stop_words);
+    LoadDocuments(search_server, options, generator, dictionary);
+    if (records.empty())
+    {
+        report.Print(cout);
+        return 0;
+    }
+
+    // Запрос i запланирован на start + (время записи i - время записи 0) / speed
+    const auto start = Clock::now() + 10ms;
+    const auto scheduled = [&](size_t i)
+    {
+        const double offset_us = (records[i].timestamp_us - records.front().timestamp_us) / options.speed;
+        return start + chrono::duration_cast<Clock::duration>(chrono::duration<double, micro>(max(offset_us, 0.0)));
+    };
+    const bool paced = options.speed > 0.0;
+    vector<uint64_t> checksums(records.size());
+    vector<vector<double>> latencies(options.threads);
+    vector<vector<double>> service_latencies(options.threads);
+    atomic_size_t next_record = 0;
+    const auto replay_start = Clock::now();
+    vector<thread> threads;
+    for (int t = 0; t < options.threads; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+                                 for (size_t i = next_record++; i < records.size(); i = next_record++)
+                                 {
+                                     const QueryLogRecord &record = records[i];
+                                     Clock::time_point planned = Clock::now();
+                                     if (paced)
+                                     {
+                                         planned = scheduled(i);
+                                         this_thread::sleep_until(planned);
+                                     }
+                                     const auto begin = Clock::now();
+                                     const DocumentStatus status = record.filter.kind == QueryFilterKind::STATUS ? record.filter.status : DocumentStatus::ACTUAL;
+                                     vector<Document> documents;
+                                     try
+                                     {
+                                         documents = search_server.FindTopDocuments(record.raw_query, status);
+                                     }
+                                     catch (const invalid_argument &)
+                                     {
+                                         // Некорректный запрос (в журнале из другой версии сервера) считается пустой выдачей
+                                     }
+                                     const auto done = Clock::now();
+                                     checksums[i] = ResultChecksum(documents);
+                                     latencies[t].push_back(chrono::duration<double, micro>(done - planned).count());
+                                     service_latencies[t].push_back(chrono::duration<double, micro>(done - begin).count());
+                                 } });
+    }
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+    const double replay_seconds = chrono::duration<double>(Clock::now() - replay_start).count();
+
+    vector<double> all_latencies;
+    vector<double> all_service_latencies;
+    for (int t = 0; t < options.threads; ++t)
+    {
+        all_latencies.insert(all_latencies.end(), latencies[t].begin(), latencies[t].end());
+        all_service_latencies.insert(all_service_latencies.end(), service_latencies[t].begin(), service_latencies[t].end());
+    }
+    uint64_t checksum = 0;
+    size_t mismatches = 0;
+    size_t unverified = 0;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        checksum += MixKey(checksums[i] ^ MixKey(i));
+        if (records[i].filter.kind != QueryFilterKind::STATUS)
+        {
+            ++unverified;
+        }
+        else
+        {
+            mismatches += checksums[i] != records[i].result_checksum;
+        }
+    }
+
+    report.Add("log.queries"sv, records.size(), "queries");
+    report.Add("log.seconds"sv, (records.back().timestamp_us - records.front().timestamp_us) / 1e6, "s");
+    report.Add("replay.seconds"sv, replay_seconds, "s");
+    report.Add("replay.throughput"sv, records.size() / replay_seconds, "queries/s");
+    if (paced)
+    {
+        report.AddLatency("replay"sv, Summarize(move(all_latencies)));
+    }
+    report.AddLatency("replay.service"sv, Summarize(move(all_service_latencies)));
+    // Младшие 32 бита: значения в отчёте печатаются с 10 значащими цифрами
+    report.Add("replay.checksum"sv, static_cast<double>(checksum & 0xffffffffu), "hash");
+    report.Add("replay.mismatches"sv, mismatches, "queries");
+    report.Add("replay.unverified"sv, unverified, "queries");
+    report.Print(cout);
+    return mismatches == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const ReplayOptions options = ParseOptions(argc, argv);
+        return options.record.empty() ? Replay(options) : Record(options);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,508 @@
+#include "query_server.h"
+#include "query_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace query_protocol;
+
+namespace
+{
+    constexpr uint64_t LISTEN_KEY = 0;
+    constexpr uint64_t WAKEUP_KEY = 1;
+    constexpr size_t READ_CHUNK_SIZE = 64u << 10;
+}
+
+QueryServer::QueryServer(SearchServer &search_server, const QueryServerOptions &options)
+    : search_server_(search_server), options_(options)
+{
+    using std::string_literals::operator""s;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options_.port);
+    if (inet_pton(AF_INET, options_.address.c_str(), &address.sin_addr) != 1)
+    {
+        throw std::invalid_argument("Invalid IPv4 address "s + options_.address);
+    }
+
+    const auto fail = [this](const std::string &what)
+    {
+        const int error = errno;
+        for (const int fd : {listen_fd_, epoll_fd_, wakeup_fd_})
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+        throw std::runtime_error(what + ": "s + std::strerror(error));
+    };
+    const int reuse = 1;
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 ||
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(listen_fd_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0 ||
+        listen(listen_fd_, SOMAXCONN) < 0)
+    {
+        fail("Cannot listen on "s + options_.address + ":"s + std::to_string(options_.port));
+    }
+    socklen_t address_size = sizeof(address);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&address), &address_size);
+    port_ = ntohs(address.sin_port);
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wakeup_fd_ < 0)
+    {
+        fail("Cannot create event loop"s);
+    }
+    for (const auto &[fd, key] : {std::pair{listen_fd_, LISTEN_KEY}, std::pair{wakeup_fd_, WAKEUP_KEY}})
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = key;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            fail("Cannot create event loop"s);
+        }
+    }
+
+    const size_t worker_count = options_.worker_count > 0 ? options_.worker_count : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        workers_.emplace_back([this]
+                              { RunWorker(); });
+    }
+}
+
+QueryServer::~QueryServer()
+{
+    {
+        std::lock_guard guard(jobs_mutex_);
+        workers_stopping_ = true;
+    }
+    jobs_ready_.notify_all();
+    for (std::thread &worker : workers_)
+    {
+        worker.join();
+    }
+    for (const auto &[connection_id, connection] : connections_)
+    {
+        close(connection.fd);
+    }
+    close(listen_fd_);
+    close(epoll_fd_);
+    close(wakeup_fd_);
+}
+
+uint16_t QueryServer::GetPort() const
+{
+    return port_;
+}
+
+void QueryServer::Run()
+{
+    using std::string_literals::operator""s;
+
+    std::vector<epoll_event> events(64);
+    while (!stopping_)
+    {
+        const int ready = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error("epoll_wait failed: "s + std::strerror(errno));
+        }
+        for (int i = 0; i < ready; ++i)
+        {
+            const uint64_t key = events[i].data.u64;
+            if (key == LISTEN_KEY)
+            {
+                AcceptConnections();
+                continue;
+            }
+            if (key == WAKEUP_KEY)
+            {
+                uint64_t count = 0;
+                [[maybe_unused]] const ssize_t received = read(wakeup_fd_, &count, sizeof(count));
+                DrainCompletions();
+                continue;
+            }
+            const auto it = connections_.find(key);
+            if (it == connections_.end())
+            {
+                continue;
+            }
+            Connection &connection = it->second;
+            const uint32_t happened = events[i].events;
+            if ((happened & (EPOLLERR | EPOLLHUP)) ||
+                ((happened & EPOLLOUT) && !WriteConnection(connection)) ||
+                ((happened & EPOLLIN) && !ReadConnection(connection)))
+            {
+                CloseConnection(key);
+                continue;
+            }
+            Advance(key, connection);
+        }
+    }
+
+    for (const auto &[connection_id, connection] : connections_)
+    {
+        close(connection.fd);
+    }
+    connections_.clear();
+}
+
+void QueryServer::Stop()
+{
+    stopping_ = true;
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t sent = write(wakeup_fd_, &one, sizeof(one));
+}
+
+QueryServerStats QueryServer::GetStats() const
+{
+    std::lock_guard guard(stats_mutex_);
+    return stats_;
+}
+
+void QueryServer::RunWorker()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(jobs_mutex_);
+            jobs_ready_.wait(lock, [this]
+                             { return workers_stopping_ || !jobs_.empty(); });
+            if (jobs_.empty())
+            {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+void QueryServer::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard guard(jobs_mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobs_ready_.notify_one();
+}
+
+void QueryServer::Complete(uint64_t connection_id, std::vector<char> response)
+{
+    {
+        std::lock_guard guard(completions_mutex_);
+        completions_.push_back({connection_id, std::move(response)});
+    }
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t sent = write(wakeup_fd_, &one, sizeof(one));
+}
+
+std::vector<char> QueryServer::Execute(const std::vector<char> &request_body)
+{
+    using std::string_literals::operator""s;
+
+    MessageReader request(request_body);
+    MessageWriter result;
+    MessageWriter response;
+    // Ошибки запросов поиска приходят кодом, без исключения: поток некорректных запросов
+    // не должен стоить раскрутки стека на каждом
+    SearchError search_error = SearchError::NONE;
+    try
+    {
+        switch (static_cast<RequestType>(request.GetU8()))
+        {
+        case RequestType::ADD_DOCUMENT:
+        {
+            const int document_id = request.GetI32();
+            const std::string document = request.GetString();
+            const auto status = static_cast<DocumentStatus>(request.GetU8());
+            std::vector<int> ratings;
+            for (uint32_t count = request.GetU32(); count > 0; --count)
+            {
+                ratings.push_back(request.GetI32());
+            }
+            std::unique_lock lock(search_server_mutex_);
+            search_server_.AddDocument(document_id, document, status, ratings);
+            break;
+        }
+        case RequestType::REMOVE_DOCUMENT:
+        {
+            const int document_id = request.GetI32();
+            std::unique_lock lock(search_server_mutex_);
+            search_server_.RemoveDocument(document_id);
+            break;
+        }
+        case RequestType::FIND_TOP:
+        {
+            const std::string raw_query = request.GetString();
+            const auto status = static_cast<DocumentStatus>(request.GetU8());
+            std::shared_lock lock(search_server_mutex_);
+            const auto outcome = search_server_.TryFindTopDocuments(std::execution::seq, raw_query, status);
+            search_error = outcome.error;
+            WriteDocuments(result, outcome.value);
+            break;
+        }
+        case RequestType::MATCH_DOCUMENT:
+        {
+            const std::string raw_query = request.GetString();
+            const int document_id = request.GetI32();
+            // Слова ссылаются на индекс: записываются, пока блокировка удерживается
+            std::shared_lock lock(search_server_mutex_);
+            const auto outcome = search_server_.TryMatchDocument(std::execution::seq, raw_query, document_id);
+            search_error = outcome.error;
+            const auto &[words, status] = outcome.value;
+            result.PutU8(static_cast<uint8_t>(status));
+            result.PutU32(static_cast<uint32_t>(words.size()));
+            for (const std::string_view word : words)
+            {
+                result.PutString(word);
+            }
+            break;
+        }
+        case RequestType::DOCUMENT_COUNT:
+        {
+            std::shared_lock lock(search_server_mutex_);
+            result.PutU32(static_cast<uint32_t>(search_server_.GetDocumentCount()));
+            break;
+        }
+        default:
+            throw std::invalid_argument("Unknown request"s);
+        }
+        if (search_error != SearchError::NONE)
+        {
+            response.PutU8(static_cast<uint8_t>(search_error == SearchError::UNKNOWN_DOCUMENT ? ResponseCode::OUT_OF_RANGE : ResponseCode::INVALID_ARGUMENT));
+            response.PutString(GetSearchErrorMessage(search_error));
+        }
+        else
+        {
+            response.PutU8(static_cast<uint8_t>(ResponseCode::OK));
+            response.Append(result);
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        response.PutU8(static_cast<uint8_t>(ResponseCode::INVALID_ARGUMENT));
+        response.PutString(e.what());
+    }
+    catch (const std::out_of_range &e)
+    {
+        response.PutU8(static_cast<uint8_t>(ResponseCode::OUT_OF_RANGE));
+        response.PutString(e.what());
+    }
+    catch (const std::exception &e)
+    {
+        response.PutU8(static_cast<uint8_t>(ResponseCode::INTERNAL_ERROR));
+        response.PutString(e.what());
+    }
+
+    MessageWriter frame;
+    frame.PutU32(static_cast<uint32_t>(response.GetData().size()));
+    frame.Append(response);
+    return frame.GetData();
+}
+
+void QueryServer::AcceptConnections()
+{
+    while (true)
+    {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // EAGAIN — очередь пуста; прочие ошибки (например, EMFILE) повторятся на следующем событии
+            return;
+        }
+        const int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        const uint64_t connection_id = next_connection_id_++;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = connection_id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            close(fd);
+            continue;
+        }
+        Connection &connection = connections_[connection_id];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+        std::lock_guard guard(stats_mutex_);
+        ++stats_.accepted_connections;
+    }
+}
+
+bool QueryServer::ReadConnection(Connection &connection)
+{
+    char buffer[READ_CHUNK_SIZE];
+    while (!connection.read_closed && connection.requests.size() < options_.max_pending_requests)
+    {
+        const ssize_t received = read(connection.fd, buffer, sizeof(buffer));
+        if (received == 0)
+        {
+            // Недописанный кадр в input уже не придёт и отбрасывается
+            connection.read_closed = true;
+            return true;
+        }
+        if (received < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.input.insert(connection.input.end(), buffer, buffer + received);
+
+        // Выделяет из буфера все полные кадры
+        size_t offset = 0;
+        while (connection.input.size() - offset >= 4)
+        {
+            uint32_t size = 0;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                size |= uint32_t{static_cast<unsigned char>(connection.input[offset + i])} << (8 * i);
+            }
+            if (size > shard_protocol::MAX_FRAME_SIZE)
+            {
+                return false;
+            }
+            if (connection.input.size() - offset - 4 < size)
+            {
+                break;
+            }
+            const auto body = connection.input.begin() + offset + 4;
+            connection.requests.emplace_back(body, body + size);
+            offset += 4 + size;
+        }
+        connection.input.erase(connection.input.begin(), connection.input.begin() + offset);
+    }
+    return true;
+}
+
+bool QueryServer::WriteConnection(Connection &connection)
+{
+    while (connection.output_offset < connection.output.size())
+    {
+        const ssize_t sent = send(connection.fd, connection.output.data() + connection.output_offset,
+                                  connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.output_offset += sent;
+    }
+    connection.output.clear();
+    connection.output_offset = 0;
+    return true;
+}
+
+void QueryServer::DrainCompletions()
+{
+    std::vector<Completion> completions;
+    {
+        std::lock_guard guard(completions_mutex_);
+        completions.swap(completions_);
+    }
+    for (Completion &completion : completions)
+    {
+        // Соединение могло закрыться, пока запрос выполнялся
+        const auto it = connections_.find(completion.connection_id);
+        if (it == connections_.end())
+        {
+            continue;
+        }
+        Connection &connection = it->second;
+        connection.busy = false;
+        connection.output.insert(connection.output.end(), completion.response.begin(), completion.response.end());
+        if (!WriteConnection(connection))
+        {
+            CloseConnection(completion.connection_id);
+            continue;
+        }
+        Advance(completion.connection_id, connection);
+    }
+}
+
+void QueryServer::Advance(uint64_t connection_id, Connection &connection)
+{
+    const size_t pending_output = connection.output.size() - connection.output_offset;
+    if (!connection.busy && !connection.requests.empty() && pending_output < options_.max_pending_output)
+    {
+        connection.busy = true;
+        Submit([this, connection_id, request = std::move(connection.requests.front())]
+               { Complete(connection_id, Execute(request)); });
+        connection.requests.pop_front();
+        std::lock_guard guard(stats_mutex_);
+        ++stats_.requests;
+    }
+    if (connection.read_closed && !connection.busy && connection.requests.empty() && pending_output == 0)
+    {
+        CloseConnection(connection_id);
+        return;
+    }
+
+    uint32_t events = 0;
+    if (!connection.read_closed && connection.requests.size() < options_.max_pending_requests && pending_output < options_.max_pending_output)
+    {
+        events |= EPOLLIN;
+    }
+    if (pending_output > 0)
+    {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events)
+    {
+        return;
+    }
+    if ((connection.events & EPOLLIN) && !(events & EPOLLIN) && !connection.read_closed)
+    {
+        std::lock_guard guard(stats_mutex_);
+        ++stats_.paused_reads;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = connection_id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event) < 0)
+    {
+        CloseConnection(connection_id);
+        return;
+    }
+    connection.events = events;
+}
+
+void QueryServer::CloseConnection(uint64_t connection_id)
+{
+    const auto it = connections_.find(connection_id);
+    if (it != connections_.end())
+    {
+        // close снимает дескриптор с epoll
+        close(it->second.fd);
+        connections_.erase(it);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "search_server.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct QueryServerOptions
+{
+    // Адрес IPv4 для прослушивания; порт 0 — выбирается системой (GetPort)
+    std::string address = "127.0.0.1";
+    uint16_t port = 0;
+    // 0 — по числу ядер
+    size_t worker_count = 0;
+    // Разобранные, но ещё не выполненные запросы одного соединения и неотправленные байты
+    // ответов, после которых сервер перестаёт читать из соединения
+    size_t max_pending_requests = 64;
+    size_t max_pending_output = 4u << 20;
+};
+
+struct QueryServerStats
+{
+    uint64_t accepted_connections = 0;
+    uint64_t requests = 0;
+    // Сколько раз чтение из соединения приостанавливалось из-за переполнения очередей
+    uint64_t paused_reads = 0;
+};
+
+/**
+ * Сетевой фронтенд SearchServer (протокол — query_protocol.h) на цикле событий epoll.
+ * Цикл событий в потоке Run только принимает соединения, читает и пишет неблокирующие
+ * сокеты; запросы выполняются пулом рабочих потоков. Запросы одного соединения
+ * выполняются по очереди, разные соединения — параллельно: поиск и сопоставление
+ * под разделяемой блокировкой, добавление и удаление — под исключительной.
+ *
+ * Противодавление на уровне соединения: если клиент отправил max_pending_requests
+ * запросов без ответа или не забирает ответы (max_pending_output), сервер перестаёт
+ * читать его сокет, и клиент упирается в буфер TCP, не отнимая память и потоки у других.
+ */
+class QueryServer
+{
+public:
+    // Открывает слушающий сокет; бросает std::invalid_argument для неверного адреса
+    // и std::runtime_error, если сокет открыть не удалось
+    QueryServer(SearchServer &search_server, const QueryServerOptions &options = {});
+    ~QueryServer();
+    QueryServer(const QueryServer &) = delete;
+    QueryServer &operator=(const QueryServer &) = delete;
+
+    uint16_t GetPort() const;
+    // Цикл событий; возвращается после Stop, закрыв все соединения
+    void Run();
+    // Можно вызывать из любого потока и из обработчика сигнала
+    void Stop();
+    // Собирается потоком Run; после его завершения — итоговая
+    QueryServerStats GetStats() const;
+
+private:
+    struct Connection
+    {
+        int fd = -1;
+        std::vector<char> input;
+        std::deque<std::vector<char>> requests;
+        // Запрос соединения выполняется в пуле
+        bool busy = false;
+        // Клиент закрыл свою сторону (shutdown(SHUT_WR)): чтение прекращено, соединение
+        // закрывается, когда выполнены принятые запросы и отправлены ответы
+        bool read_closed = false;
+        std::vector<char> output;
+        size_t output_offset = 0;
+        uint32_t events = 0;
+    };
+
+    struct Completion
+    {
+        uint64_t connection_id;
+        std::vector<char> response;
+    };
+
+    SearchServer &search_server_;
+    QueryServerOptions options_;
+    std::shared_mutex search_server_mutex_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    // Будит цикл событий: готовые ответы и Stop
+    int wakeup_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic_bool stopping_ = false;
+    // Ключ epoll: 0 — слушающий сокет, 1 — wakeup_fd_, дальше — id соединений
+    uint64_t next_connection_id_ = 2;
+    std::map<uint64_t, Connection> connections_;
+    mutable std::mutex stats_mutex_;
+    QueryServerStats stats_;
+
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_ready_;
+    std::deque<std::function<void()>> jobs_;
+    bool workers_stopping_ = false;
+    std::vector<std::thread> workers_;
+    std::mutex completions_mutex_;
+    std::vector<Completion> completions_;
+
+    void RunWorker();
+    void Submit(std::function<void()> job);
+    void Complete(uint64_t connection_id, std::vector<char> response);
+    // Выполняет тело запроса и возвращает кадр ответа
+    std::vector<char> Execute(const std::vector<char> &request);
+
+    void AcceptConnections();
+    // Читают и пишут сокет до EAGAIN; false — соединение нужно закрыть
+    bool ReadConnection(Connection &connection);
+    bool WriteConnection(Connection &connection);
+    void DrainCompletions();
+    // Отдаёт следующий запрос соединения в пул и обновляет события epoll
+    void Advance(uint64_t connection_id, Connection &connection);
+    void CloseConnection(uint64_t connection_id);
+};
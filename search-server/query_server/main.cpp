@@ -0,0 +1,94 @@
+// Сетевой сервер поиска: QueryServer над пустым SearchServer.
+//
+// Документы добавляются и ищутся по TCP (протокол — query_protocol.h), например
+// нагрузочным клиентом ../load_generator. Работает до SIGINT или SIGTERM, после чего
+// печатает статистику соединений.
+//
+// Сборка (из каталога search-server/query_server):
+//   g++ --std=c++17 -O2 -pthread main.cpp $(ls ../*.cpp | grep -v main.cpp) -o build/main -ltbb
+//
+// Пример:
+//   ./build/main --port=7000 --workers=8 --stop-words="and in on"
+
+#include "../search_server.h"
+#include "../query_server.h"
+#include <csignal>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace
+{
+    QueryServer *running_server = nullptr;
+
+    void StopServer(int)
+    {
+        running_server->Stop();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    QueryServerOptions options;
+    options.port = 7000;
+    string stop_words;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const string_view arg = argv[i];
+            const auto eq = arg.find('=');
+            if (arg.substr(0, 2) != "--"sv || eq == arg.npos)
+            {
+                throw invalid_argument("Expected --name=value, got "s + string(arg));
+            }
+            const string_view name = arg.substr(2, eq - 2);
+            const string value(arg.substr(eq + 1));
+            if (name == "address"sv)
+            {
+                options.address = value;
+            }
+            else if (name == "port"sv)
+            {
+                options.port = static_cast<uint16_t>(stoul(value));
+            }
+            else if (name == "workers"sv)
+            {
+                options.worker_count = stoul(value);
+            }
+            else if (name == "max-pending"sv)
+            {
+                options.max_pending_requests = stoul(value);
+            }
+            else if (name == "stop-words"sv)
+            {
+                stop_words = value;
+            }
+            else
+            {
+                throw invalid_argument("Unknown option "s + string(name));
+            }
+        }
+
+        SearchServer search_server(stop_words);
+        QueryServer server(search_server, options);
+        running_server = &server;
+        signal(SIGINT, StopServer);
+        signal(SIGTERM, StopServer);
+        cerr << "Listening on "s << options.address << ":"s << server.GetPort() << endl;
+        server.Run();
+
+        const QueryServerStats stats = server.GetStats();
+        cerr << "connections: "s << stats.accepted_connections
+             << ", requests: "s << stats.requests
+             << ", paused reads: "s << stats.paused_reads
+             << ", documents: "s << search_server.GetDocumentCount() << endl;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "rating_index.h"
+#include <algorithm>
+
+void RatingIndex::Add(Slot slot, int rating)
+{
+    Bucket *bucket = &buckets_[rating];
+    ++bucket->count;
+    if (!bucket->IsDense())
+    {
+        // Слоты обычно выдаются по возрастанию, и вставка приходится в конец
+        bucket->slots.insert(std::upper_bound(bucket->slots.begin(), bucket->slots.end(), slot), slot);
+        if (bucket->count >= MIN_DENSE_COUNT && bucket->count * DENSE_SPAN >= bucket->slots.back() + size_t{1})
+        {
+            MakeDense(*bucket);
+        }
+        return;
+    }
+    const size_t word = slot >> 6;
+    if (bucket->words.size() <= word)
+    {
+        bucket->words.resize(word + 1);
+    }
+    bucket->words[word] |= uint64_t{1} << (slot & 63);
+    bucket->first_word = std::min(bucket->first_word, word);
+    if (bucket->count * SPARSE_SPAN < bucket->words.size() * 64)
+    {
+        MakeSparse(*bucket);
+    }
+}
+
+void RatingIndex::Remove(Slot slot, int rating)
+{
+    const auto it = buckets_.find(rating);
+    if (it == buckets_.end())
+    {
+        return;
+    }
+    Bucket *bucket = &it->second;
+    if (--bucket->count == 0)
+    {
+        buckets_.erase(it);
+        return;
+    }
+    if (!bucket->IsDense())
+    {
+        const auto slot_it = std::lower_bound(bucket->slots.begin(), bucket->slots.end(), slot);
+        if (slot_it != bucket->slots.end() && *slot_it == slot)
+        {
+            bucket->slots.erase(slot_it);
+        }
+        return;
+    }
+    bucket->words[slot >> 6] &= ~(uint64_t{1} << (slot & 63));
+    while (bucket->words.back() == 0)
+    {
+        bucket->words.pop_back();
+    }
+    while (bucket->words[bucket->first_word] == 0)
+    {
+        ++bucket->first_word;
+    }
+    if (bucket->count * SPARSE_SPAN < bucket->words.size() * 64)
+    {
+        MakeSparse(*bucket);
+    }
+}
+
+size_t RatingIndex::CountRatings(int min_rating, int max_rating, size_t limit) const
+{
+    size_t count = 0;
+    for (auto it = buckets_.lower_bound(min_rating); count < limit && it != buckets_.end() && it->first <= max_rating; ++it)
+    {
+        ++count;
+    }
+    return count;
+}
+
+uint64_t RatingIndex::SelectWord(int min_rating, int max_rating, size_t word) const
+{
+    uint64_t mask = 0;
+    for (auto it = buckets_.lower_bound(min_rating); it != buckets_.end() && it->first <= max_rating; ++it)
+    {
+        const Bucket *bucket = &it->second;
+        if (bucket->IsDense())
+        {
+            if (word < bucket->words.size())
+            {
+                mask |= bucket->words[word];
+            }
+            continue;
+        }
+        const Slot first_slot = static_cast<Slot>(word * 64);
+        for (auto it = std::lower_bound(bucket->slots.begin(), bucket->slots.end(), first_slot);
+             it != bucket->slots.end() && *it - first_slot < 64; ++it)
+        {
+            mask |= uint64_t{1} << (*it - first_slot);
+        }
+    }
+    return mask;
+}
+
+void RatingIndex::MakeDense(Bucket &bucket)
+{
+    bucket.words.assign(bucket.slots.back() / 64 + 1, 0);
+    bucket.first_word = bucket.slots.front() / 64;
+    for (const Slot slot : bucket.slots)
+    {
+        bucket.words[slot >> 6] |= uint64_t{1} << (slot & 63);
+    }
+    bucket.slots.clear();
+    bucket.slots.shrink_to_fit();
+}
+
+void RatingIndex::MakeSparse(Bucket &bucket)
+{
+    bucket.slots.clear();
+    bucket.slots.reserve(bucket.count);
+    for (size_t word = bucket.first_word; word < bucket.words.size(); ++word)
+    {
+        for (uint64_t bits = bucket.words[word]; bits != 0; bits &= bits - 1)
+        {
+            bucket.slots.push_back(static_cast<Slot>(word * 64 + __builtin_ctzll(bits)));
+        }
+    }
+    bucket.words.clear();
+    bucket.words.shrink_to_fit();
+    bucket.first_word = 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * Вторичный индекс по рейтингу документов: для каждого встречающегося значения рейтинга —
+ * слоты документов с этим рейтингом. Редкий рейтинг хранит отсортированный список слотов,
+ * частый (хотя бы один документ на DENSE_SPAN слотов своего диапазона) — битовую карту.
+ * Память — не больше 16 байт на документ в списках и картах плюс узел словаря с Bucket
+ * (около 100 байт) на каждое различное значение рейтинга; добавление нового значения — O(log R).
+ * Отбор по диапазону рейтингов — объединение слотов по 64 документа за вызов, обход
+ * по убыванию рейтинга — перебор значений с конца; обход читает в среднем не больше
+ * двух слов карты на найденный документ, пустые диапазоны не просматриваются.
+ */
+class RatingIndex
+{
+public:
+    using Slot = uint32_t;
+
+    void Add(Slot slot, int rating);
+    void Remove(Slot slot, int rating);
+
+    // Число различных рейтингов в [min_rating, max_rating], но не больше limit:
+    // перебирается не больше limit значений
+    size_t CountRatings(int min_rating, int max_rating, size_t limit) const;
+
+    // Слоты с word * 64 по word * 64 + 63 с рейтингом в [min_rating, max_rating]
+    uint64_t SelectWord(int min_rating, int max_rating, size_t word) const;
+
+    // Вызывает func(slot, rating) по убыванию рейтинга (при равном — по возрастанию слота),
+    // пока func возвращает true
+    template <typename Func>
+    void ForEachDescending(Func func) const
+    {
+        for (auto it = buckets_.rbegin(); it != buckets_.rend(); ++it)
+        {
+            const int rating = it->first;
+            const Bucket *bucket = &it->second;
+            if (!bucket->IsDense())
+            {
+                for (const Slot slot : bucket->slots)
+                {
+                    if (!func(slot, rating))
+                    {
+                        return;
+                    }
+                }
+                continue;
+            }
+            for (size_t word = bucket->first_word; word < bucket->words.size(); ++word)
+            {
+                for (uint64_t bits = bucket->words[word]; bits != 0; bits &= bits - 1)
+                {
+                    const auto slot = static_cast<Slot>(word * 64 + __builtin_ctzll(bits));
+                    if (!func(slot, rating))
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    // Карта заводится, когда документов рейтинга не меньше (диапазон слотов) / DENSE_SPAN,
+    // и снимается, когда их становится меньше (длина карты) / SPARSE_SPAN: между порогами
+    // представление не меняется, и добавление с удалением не перестраивают его по кругу
+    static constexpr size_t DENSE_SPAN = 32;
+    static constexpr size_t SPARSE_SPAN = 128;
+    static constexpr size_t MIN_DENSE_COUNT = 64;
+
+    struct Bucket
+    {
+        size_t count = 0;
+        // Редкий рейтинг: слоты по возрастанию
+        std::vector<Slot> slots;
+        // Частый рейтинг: битовая карта до последнего слота и первое непустое слово
+        std::vector<uint64_t> words;
+        size_t first_word = 0;
+
+        bool IsDense() const
+        {
+            return !words.empty();
+        }
+    };
+
+    // Узлы словаря не перемещаются: новое значение рейтинга не сдвигает остальные
+    std::map<int, Bucket> buckets_;
+
+    static void MakeDense(Bucket &bucket);
+    static void MakeSparse(Bucket &bucket);
+};
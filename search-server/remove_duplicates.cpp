@@ -1,35 +1,337 @@
 #include "remove_duplicates.h"
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <iostream>
+#include <limits>
 #include <map>
+#include <numeric>
+#include <unordered_map>
 #include <vector>
-#include <iostream>
+
+namespace
+{
+    // Отпечаток множества слов документа: суммы двух независимых 64-битных хэшей id слов.
+    // Сумма не зависит от порядка слов, поэтому отпечаток можно считать по любому обходу
+    struct Fingerprint
+    {
+        uint64_t low = 0;
+        uint64_t high = 0;
+        size_t word_count = 0;
+
+        bool operator==(const Fingerprint &other) const
+        {
+            return low == other.low && high == other.high && word_count == other.word_count;
+        }
+    };
+
+    struct FingerprintHasher
+    {
+        size_t operator()(const Fingerprint &fingerprint) const
+        {
+            return fingerprint.low ^ (fingerprint.high * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    Fingerprint ComputeFingerprint(const std::vector<SearchServer::TermId> &term_ids)
+    {
+        Fingerprint result;
+        for (const SearchServer::TermId term_id : term_ids)
+        {
+            result.low += MixKey(term_id);
+            result.high += MixKey(term_id ^ 0x5bd1e9955bd1e995ULL);
+        }
+        result.word_count = term_ids.size();
+        return result;
+    }
+}
 
 void RemoveDuplicates(SearchServer &search_server)
 {
     using std::string_literals::operator""s;
+
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    std::vector<Fingerprint> fingerprints(document_ids.size());
+    std::transform(std::execution::par,
+                   document_ids.begin(), document_ids.end(),
+                   fingerprints.begin(),
+                   [&search_server](int document_id)
+                   {
+                       return ComputeFingerprint(search_server.GetDocumentTermIds(document_id));
+                   });
+
+    // Для каждого отпечатка — индексы оставленных документов. Больше одного
+    // индекса бывает только при коллизии отпечатков разных множеств слов
+    std::unordered_map<Fingerprint, std::vector<size_t>, FingerprintHasher> originals;
+    originals.reserve(document_ids.size());
     std::vector<int> id_for_delete;
-    std::set<std::set<std::string_view>> tmp;
+    for (size_t i = 0; i < document_ids.size(); ++i)
+    {
+        auto &candidates = originals[fingerprints[i]];
+        // Id слов в прямом индексе отсортированы: одинаковые множества дают равные векторы
+        const auto &term_ids = search_server.GetDocumentTermIds(document_ids[i]);
+        const bool is_duplicate = std::any_of(candidates.begin(), candidates.end(), [&](size_t original)
+                                              { return search_server.GetDocumentTermIds(document_ids[original]) == term_ids; });
+        if (is_duplicate)
+        {
+            id_for_delete.push_back(document_ids[i]);
+        }
+        else
+        {
+            candidates.push_back(i);
+        }
+    }
+
+    search_server.RemoveDocuments(id_for_delete);
+    for (int id : id_for_delete)
+    {
+        std::cout << "Found duplicate document id "s << id << std::endl;
+    }
+}
+
+NearDuplicateOptions::NearDuplicateOptions(double threshold, int signature_size)
+    : threshold(threshold)
+{
+    using std::string_literals::operator""s;
+
+    // Иначе перебор ниже не находит разбиения и молча оставляет 16 x 8, а при пороге
+    // выше единицы ни один кандидат не проходит проверку
+    if (!(threshold > 0.0 && threshold <= 1.0))
+    {
+        throw std::invalid_argument("Threshold must be in (0, 1]"s);
+    }
+    if (signature_size <= 0)
+    {
+        throw std::invalid_argument("Signature size must be positive"s);
+    }
+    // Порог LSH берётся не выше заданного: недостающую точность даёт проверка кандидатов
+    double best_point = -1.0;
+    for (int candidate_rows = 1; candidate_rows <= signature_size; ++candidate_rows)
+    {
+        if (signature_size % candidate_rows != 0)
+        {
+            continue;
+        }
+        const int candidate_bands = signature_size / candidate_rows;
+        const double point = std::pow(1.0 / candidate_bands, 1.0 / candidate_rows);
+        if (point <= threshold && point > best_point)
+        {
+            best_point = point;
+            bands = candidate_bands;
+            rows = candidate_rows;
+        }
+    }
+}
+
+namespace
+{
+    double ComputeJaccard(const std::vector<SearchServer::TermId> &lhs, const std::vector<SearchServer::TermId> &rhs)
+    {
+        size_t common = 0;
+        for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end() && r != rhs.end();)
+        {
+            if (*l < *r)
+            {
+                ++l;
+            }
+            else if (*r < *l)
+            {
+                ++r;
+            }
+            else
+            {
+                ++common;
+                ++l;
+                ++r;
+            }
+        }
+        const size_t total = lhs.size() + rhs.size() - common;
+        return total == 0 ? 1.0 : common * 1.0 / total;
+    }
+}
+
+std::vector<std::vector<int>> FindNearDuplicates(const SearchServer &search_server, double threshold)
+{
+    return FindNearDuplicates(search_server, NearDuplicateOptions(threshold));
+}
 
+std::vector<std::vector<int>> FindNearDuplicates(const SearchServer &search_server, const NearDuplicateOptions &options)
+{
+    using std::string_literals::operator""s;
+
+    if (options.bands <= 0 || options.rows <= 0)
+    {
+        throw std::invalid_argument("Bands and rows must be positive"s);
+    }
+    if (!(options.threshold > 0.0 && options.threshold <= 1.0))
+    {
+        throw std::invalid_argument("Threshold must be in (0, 1]"s);
+    }
+
+    // Документы без слов ни на что не похожи и в поиск не попадают
+    std::vector<int> document_ids;
     for (const int document_id : search_server)
     {
-        std::set<std::string_view> buff;
-        for (auto &[word, tf] : search_server.GetWordFrequencies(document_id))
+        if (!search_server.GetDocumentTermIds(document_id).empty())
+        {
+            document_ids.push_back(document_id);
+        }
+    }
+
+    // Сигнатуры MinHash: по 32 бита на хэш, document_ids.size() * signature_size значений
+    const size_t signature_size = static_cast<size_t>(options.bands) * options.rows;
+    std::vector<uint32_t> signatures(document_ids.size() * signature_size);
+    std::vector<size_t> indexes(document_ids.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par,
+                  indexes.begin(), indexes.end(),
+                  [&](size_t index)
+                  {
+                      uint32_t *signature = signatures.data() + index * signature_size;
+                      std::fill(signature, signature + signature_size, std::numeric_limits<uint32_t>::max());
+                      for (const SearchServer::TermId term_id : search_server.GetDocumentTermIds(document_ids[index]))
+                      {
+                          const uint64_t word_hash = MixKey(term_id);
+                          for (size_t k = 0; k < signature_size; ++k)
+                          {
+                              const auto value = static_cast<uint32_t>(MixKey(word_hash ^ (options.seed * (k + 1))) >> 32);
+                              signature[k] = std::min(signature[k], value);
+                          }
+                      }
+                  });
+
+    const auto is_similar = [&](size_t lhs, size_t rhs)
+    {
+        if (options.exact_verification)
+        {
+            return ComputeJaccard(search_server.GetDocumentTermIds(document_ids[lhs]),
+                                  search_server.GetDocumentTermIds(document_ids[rhs])) >= options.threshold;
+        }
+        const uint32_t *l = signatures.data() + lhs * signature_size;
+        const uint32_t *r = signatures.data() + rhs * signature_size;
+        size_t equal = 0;
+        for (size_t k = 0; k < signature_size; ++k)
         {
-            buff.insert(word);
+            equal += l[k] == r[k];
         }
+        return equal * 1.0 / signature_size >= options.threshold;
+    };
 
-        if (tmp.find(buff) == tmp.end())
+    // Группа — документ-представитель и похожие на него не ниже порога. Документ входит
+    // в группу, только если похож на её представителя, а группы не сливаются: иначе
+    // цепочки похожих пар собрали бы в одну группу документы, далёкие друг от друга
+    constexpr size_t NO_GROUP = std::numeric_limits<size_t>::max();
+    std::vector<size_t> representatives(document_ids.size(), NO_GROUP);
+
+    // Полосы обрабатываются по одной, чтобы память не росла с их числом.
+    // Внутри корзины документ сравнивается с первым документом корзины, а в корзинах
+    // не крупнее max_bucket_size — ещё и с предыдущим: сравнений линейно по размеру корзины,
+    // и большие кластеры одинаковых документов тоже находятся
+    std::vector<std::pair<uint64_t, size_t>> band_hashes(document_ids.size());
+    std::vector<std::pair<size_t, size_t>> candidates;
+    // Проверки (документ без группы, представитель или второй документ без группы)
+    std::vector<std::pair<size_t, size_t>> checks;
+    for (int band = 0; band < options.bands; ++band)
+    {
+        std::transform(std::execution::par,
+                       indexes.begin(), indexes.end(),
+                       band_hashes.begin(),
+                       [&](size_t index)
+                       {
+                           const uint32_t *rows = signatures.data() + index * signature_size + band * options.rows;
+                           uint64_t hash = band;
+                           for (int row = 0; row < options.rows; ++row)
+                           {
+                               hash = MixKey(hash ^ rows[row]);
+                           }
+                           return std::pair{hash, index};
+                       });
+        std::sort(std::execution::par, band_hashes.begin(), band_hashes.end());
+
+        candidates.clear();
+        for (size_t begin = 0, end = 0; begin < band_hashes.size(); begin = end)
         {
-            tmp.insert(buff);
+            while (end < band_hashes.size() && band_hashes[end].first == band_hashes[begin].first)
+            {
+                ++end;
+            }
+            const bool compare_neighbours = end - begin <= options.max_bucket_size;
+            for (size_t i = begin + 1; i < end; ++i)
+            {
+                candidates.emplace_back(band_hashes[begin].second, band_hashes[i].second);
+                if (compare_neighbours && i > begin + 1)
+                {
+                    candidates.emplace_back(band_hashes[i - 1].second, band_hashes[i].second);
+                }
+            }
         }
-        else
+
+        // Пара, где оба документа уже в группах, ничего не меняет; иначе документ без группы
+        // проверяется против представителя группы второго
+        checks.clear();
+        for (const auto &[lhs, rhs] : candidates)
         {
-            id_for_delete.push_back(document_id);
+            const size_t lhs_group = representatives[lhs];
+            const size_t rhs_group = representatives[rhs];
+            if (lhs_group == NO_GROUP && rhs_group == NO_GROUP)
+            {
+                checks.emplace_back(rhs, lhs);
+            }
+            else if (lhs_group == NO_GROUP)
+            {
+                checks.emplace_back(lhs, rhs_group);
+            }
+            else if (rhs_group == NO_GROUP)
+            {
+                checks.emplace_back(rhs, lhs_group);
+            }
+        }
+        std::sort(checks.begin(), checks.end());
+        checks.erase(std::unique(checks.begin(), checks.end()), checks.end());
+        std::vector<char> verified(checks.size());
+        std::transform(std::execution::par,
+                       checks.begin(), checks.end(),
+                       verified.begin(),
+                       [&is_similar](const auto &check)
+                       {
+                           return is_similar(check.first, check.second);
+                       });
+        // Проверки сделаны по группам на начало полосы: принимается только та, чья цель
+        // к этому моменту всё ещё представитель или документ без группы
+        for (size_t i = 0; i < checks.size(); ++i)
+        {
+            const auto [document, target] = checks[i];
+            if (!verified[i] || representatives[document] != NO_GROUP)
+            {
+                continue;
+            }
+            if (representatives[target] == NO_GROUP)
+            {
+                representatives[target] = target;
+            }
+            if (representatives[target] == target)
+            {
+                representatives[document] = target;
+            }
         }
     }
 
-    for (int id : id_for_delete)
+    std::map<size_t, std::vector<int>> groups;
+    for (size_t index = 0; index < document_ids.size(); ++index)
     {
-        search_server.RemoveDocument(id);
-        std::cout << "Found duplicate document id "s << id << std::endl;
+        if (representatives[index] != NO_GROUP)
+        {
+            groups[representatives[index]].push_back(document_ids[index]);
+        }
+    }
+    std::vector<std::vector<int>> result;
+    for (auto &[representative, group] : groups)
+    {
+        if (group.size() > 1)
+        {
+            result.push_back(std::move(group));
+        }
     }
-}
\ No newline at end of file
+    std::sort(result.begin(), result.end());
+    return result;
+}
@@ -1,4 +1,33 @@
 #pragma once
 #include "search_server.h"
+#include <vector>
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+void RemoveDuplicates(SearchServer& search_server);
+
+// Параметры поиска почти-дубликатов (MinHash + LSH).
+// Сигнатура документа состоит из bands * rows минимальных хэшей его слов. Пара документов
+// с мерой Жаккара s становится кандидатом с вероятностью 1 - (1 - s^rows)^bands:
+// больше bands — выше полнота, больше rows — выше точность
+struct NearDuplicateOptions
+{
+    NearDuplicateOptions() = default;
+    // Подбирает bands и rows так, чтобы точка перегиба (1/bands)^(1/rows) была ближайшей к threshold снизу.
+    // threshold должен лежать в (0, 1], signature_size — быть положительным, иначе std::invalid_argument
+    explicit NearDuplicateOptions(double threshold, int signature_size = 128);
+
+    double threshold = 0.8;
+    int bands = 16;
+    int rows = 8;
+    // Кандидаты проверяются точной мерой Жаккара по словам, иначе — оценкой по сигнатурам
+    bool exact_verification = false;
+    // В корзинах LSH крупнее этого размера документ сравнивается только с первым документом
+    // корзины, а не ещё и с соседним: ограничивает число сравнений
+    size_t max_bucket_size = 1000;
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+};
+
+// Группы похожих документов по мере Жаккара множеств слов. В каждой группе есть представитель,
+// и каждый документ группы похож на него не ниже порога; поэтому любые два документа группы
+// похожи не ниже 2 * threshold - 1. Документы в группе и группы — по возрастанию id
+std::vector<std::vector<int>> FindNearDuplicates(const SearchServer &search_server, double threshold);
+std::vector<std::vector<int>> FindNearDuplicates(const SearchServer &search_server, const NearDuplicateOptions &options);
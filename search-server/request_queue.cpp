@@ -4,13 +4,20 @@ RequestQueue::RequestQueue(const SearchServer &search_server) : search_server_(s
 {
     // напишите реализацию
 }
+
+RequestQueue::RequestQueue(const SearchServer &search_server, QueryLogWriter &query_log)
+    : search_server_(search_server), query_log_(&query_log)
+{
+}
 // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, DocumentStatus status)
 {
     // напишите реализацию
-    return AddFindRequest(raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-                          { return document_status == status; });
+    return AddFindRequest(
+        raw_query, [status](int document_id, DocumentStatus document_status, int rating)
+        { return document_status == status; },
+        QueryFilter{QueryFilterKind::STATUS, status});
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query)
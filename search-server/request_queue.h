@@ -2,7 +2,9 @@
 #include "search_server.h"
 #include "document.h"
 #include "paginator.h"
+#include "query_log.h"
 #include <deque>
+#include <type_traits>
 
 template <typename Container>
 auto Paginate(const Container &c, size_t page_size)
@@ -14,6 +16,8 @@ class RequestQueue
 {
 public:
     explicit RequestQueue(const SearchServer &search_server);
+    // Каждый запрос, его фильтр, время и контрольная сумма выдачи дописываются в query_log
+    RequestQueue(const SearchServer &search_server, QueryLogWriter &query_log);
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentStatus status);
@@ -31,14 +35,37 @@ private:
     int now_time = 0;
     const static int min_in_day_ = 1440;
     const SearchServer &search_server_;
+    QueryLogWriter *query_log_ = nullptr;
     // возможно, здесь вам понадобится что-то ещё
+
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate, QueryFilter filter);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate)
+{
+    QueryFilter filter;
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>)
+    {
+        filter.status = document_predicate;
+    }
+    else
+    {
+        filter.kind = QueryFilterKind::PREDICATE;
+    }
+    return AddFindRequest(raw_query, document_predicate, filter);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> RequestQueue::AddFindRequest(const std::string &raw_query, DocumentPredicate document_predicate, QueryFilter filter)
 {
     // напишите реализацию
     const std::vector<Document> &res = RequestQueue::search_server_.FindTopDocuments(raw_query, document_predicate);
+    if (query_log_)
+    {
+        query_log_->Append(raw_query, filter, res);
+    }
     RequestQueue::QueryResult buff;
     buff.status_failed = res.empty();
     now_time++;
@@ -51,10 +51,21 @@ void MatchDocuments(const SearchServer &search_server, const std::string_view qu
     try
     {
         std::cout << "Матчинг документов по запросу: "s << query << std::endl;
+        // Запрос разбирается один раз; документы без совпадений печатаются с пустым списком слов
+        const auto rows = search_server.MatchAllDocuments(std::execution::par, query, [](int, DocumentStatus, int)
+                                                          { return true; });
+        auto row = rows.begin();
         for (const int document_id : search_server)
         {
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
-            PrintMatchDocumentResult(document_id, words, status);
+            if (row != rows.end() && row->id == document_id)
+            {
+                PrintMatchDocumentResult(document_id, row->words, row->status);
+                ++row;
+            }
+            else
+            {
+                PrintMatchDocumentResult(document_id, {}, search_server.GetDocumentStatus(document_id));
+            }
         }
     }
     catch (const std::invalid_argument &e)
@@ -71,18 +82,43 @@ void SearchServer::AddDocument(int document_id, const std::string_view document,
     {
         throw std::invalid_argument("Invalid document_id"s);
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, std::string(document), {}});
-    const auto words = SplitIntoWordsNoStop(documents_.at(document_id).data_str);
-    const double inv_word_count = 1.0 / words.size();
-    std::map<std::string_view, double> wf;
+    // Разбор до вставки: при некорректном слове сервер остаётся неизменным
+    static thread_local std::string document_text;
+    static thread_local std::vector<std::string_view> words;
+    const WordError split_error = SplitIntoWordsNoStop(document, document_text, words);
+    if (split_error.error != SearchError::NONE)
+    {
+        throw std::invalid_argument("Word "s + std::string(split_error.word) + " is invalid"s);
+    }
+
+    // Прямой индекс строится сортировкой id слов: повторы слова соседствуют и суммируются
+    static thread_local std::vector<TermId> term_ids;
+    term_ids.clear();
     for (const std::string_view word : words)
     {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
-        wf[word] += inv_word_count;
+        term_ids.push_back(GetOrCreateTerm(word)->second.term_id);
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+
+    const DocumentColumns::Slot slot = columns_.Add(document_id, ComputeAverageRating(ratings), status);
+    DocumentData &document_data = documents_.emplace(document_id, DocumentData{slot, {}, {}}).first->second;
+    const double inv_word_count = 1.0 / words.size();
+    for (size_t begin = 0, end = 0; begin < term_ids.size(); begin = end)
+    {
+        double term_freq = 0.0;
+        while (end < term_ids.size() && term_ids[end] == term_ids[begin])
+        {
+            term_freq += inv_word_count;
+            ++end;
+        }
+        document_data.term_ids.push_back(term_ids[begin]);
+        document_data.term_freqs.push_back(term_freq);
+        WordPostings &postings = terms_[term_ids[begin]]->second;
+        postings.document_freqs.emplace(document_id, Posting{term_freq, slot});
+        UpdateWordStatistics(postings);
     }
     document_ids_.insert(document_id);
-    documents_.at(document_id).word_f = wf;
+    OnDocumentsChanged();
 }
 
 SearchServer::SearchServer(const std::string &stop_words_text)
@@ -96,6 +132,87 @@ SearchServer::SearchServer(const std::string_view stop_words_text)
 {
 }
 
+SearchServer::SearchServer(const std::string &stop_words_text, const TextAnalyzer &analyzer)
+    : SearchServer(std::string_view(stop_words_text), analyzer)
+{
+}
+
+SearchServer::SearchServer(const std::string_view stop_words_text, const TextAnalyzer &analyzer)
+    : SearchServer(SplitIntoWords(stop_words_text), analyzer)
+{
+}
+
+SearchServer::SearchServer(const SearchServer &other)
+    : analyzer_(other.analyzer_),
+      stop_words_(other.stop_words_),
+      stop_word_set_(other.stop_word_set_),
+      word_to_document_freqs_(other.word_to_document_freqs_),
+      terms_(other.terms_.size()),
+      free_term_ids_(other.free_term_ids_),
+      log_document_count_(other.log_document_count_),
+      impact_precision_(other.impact_precision_),
+      impact_quantum_(other.impact_quantum_),
+      ordered_by_static_rank_(other.ordered_by_static_rank_),
+      documents_(other.documents_),
+      columns_(other.columns_),
+      document_ids_(other.document_ids_),
+      execution_planner_(other.execution_planner_)
+{
+    RebuildTerms();
+}
+
+SearchServer::SearchServer(SearchServer &&other) noexcept
+    : analyzer_(std::move(other.analyzer_)),
+      stop_words_(std::move(other.stop_words_)),
+      stop_word_set_(std::move(other.stop_word_set_)),
+      word_to_document_freqs_(std::move(other.word_to_document_freqs_)),
+      terms_(std::move(other.terms_)),
+      free_term_ids_(std::move(other.free_term_ids_)),
+      log_document_count_(other.log_document_count_),
+      impact_precision_(other.impact_precision_),
+      impact_quantum_(other.impact_quantum_),
+      ordered_by_static_rank_(other.ordered_by_static_rank_),
+      documents_(std::move(other.documents_)),
+      columns_(std::move(other.columns_)),
+      document_ids_(std::move(other.document_ids_)),
+      execution_planner_(other.execution_planner_)
+{
+    // Узлы словаря переходят вместе с ним, но освобождённые id указывали на end() источника
+    RebuildTerms();
+}
+
+SearchServer &SearchServer::operator=(const SearchServer &other)
+{
+    if (this != &other)
+    {
+        *this = SearchServer(other);
+    }
+    return *this;
+}
+
+SearchServer &SearchServer::operator=(SearchServer &&other) noexcept
+{
+    if (this != &other)
+    {
+        analyzer_ = std::move(other.analyzer_);
+        stop_words_ = std::move(other.stop_words_);
+        stop_word_set_ = std::move(other.stop_word_set_);
+        word_to_document_freqs_ = std::move(other.word_to_document_freqs_);
+        terms_ = std::move(other.terms_);
+        free_term_ids_ = std::move(other.free_term_ids_);
+        log_document_count_ = other.log_document_count_;
+        impact_precision_ = other.impact_precision_;
+        impact_quantum_ = other.impact_quantum_;
+        ordered_by_static_rank_ = other.ordered_by_static_rank_;
+        documents_ = std::move(other.documents_);
+        columns_ = std::move(other.columns_);
+        document_ids_ = std::move(other.document_ids_);
+        execution_planner_ = other.execution_planner_;
+        RebuildTerms();
+    }
+    return *this;
+}
+
 std::set<int>::const_iterator SearchServer::begin() const
 {
     return document_ids_.begin();
@@ -106,17 +223,81 @@ std::set<int>::const_iterator SearchServer::end() const
     return document_ids_.end();
 }
 
-const std::map<std::string_view, double> &SearchServer::GetWordFrequencies(int document_id) const
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const
+{
+    std::map<std::string_view, double> word_freqs;
+    const auto it = documents_.find(document_id);
+    if (it != documents_.end())
+    {
+        const DocumentData &document_data = it->second;
+        for (size_t i = 0; i < document_data.term_ids.size(); ++i)
+        {
+            word_freqs.emplace(GetTermWord(document_data.term_ids[i]), document_data.term_freqs[i]);
+        }
+    }
+    return word_freqs;
+}
+
+const std::vector<SearchServer::TermId> &SearchServer::GetDocumentTermIds(int document_id) const
 {
-    std::map<int, std::map<std::string_view, double>>::const_iterator res = document_to_word_freqs_.find(document_id);
-    if (res != document_to_word_freqs_.end())
+    const auto it = documents_.find(document_id);
+    if (it != documents_.end())
     {
-        return res->second;
+        return it->second.term_ids;
     }
-    static const std::map<std::string_view, double> dummy;
+    static const std::vector<TermId> dummy;
     return dummy;
 }
 
+std::string_view SearchServer::GetTermWord(TermId term_id) const
+{
+    using std::string_literals::operator""s;
+
+    if (term_id >= terms_.size() || terms_[term_id] == word_to_document_freqs_.end())
+    {
+        throw std::out_of_range("Unknown term id"s);
+    }
+    return terms_[term_id]->first;
+}
+
+SearchServer::TermIndex::iterator SearchServer::GetOrCreateTerm(const std::string_view word)
+{
+    auto it = word_to_document_freqs_.find(word);
+    if (it != word_to_document_freqs_.end())
+    {
+        return it;
+    }
+    it = word_to_document_freqs_.emplace(std::string(word), WordPostings{}).first;
+    if (free_term_ids_.empty())
+    {
+        it->second.term_id = static_cast<TermId>(terms_.size());
+        terms_.push_back(it);
+    }
+    else
+    {
+        it->second.term_id = free_term_ids_.back();
+        free_term_ids_.pop_back();
+        terms_[it->second.term_id] = it;
+    }
+    return it;
+}
+
+void SearchServer::ReleaseTerm(TermId term_id)
+{
+    word_to_document_freqs_.erase(terms_[term_id]);
+    terms_[term_id] = word_to_document_freqs_.end();
+    free_term_ids_.push_back(term_id);
+}
+
+void SearchServer::RebuildTerms()
+{
+    terms_.assign(terms_.size(), word_to_document_freqs_.end());
+    for (auto it = word_to_document_freqs_.begin(); it != word_to_document_freqs_.end(); ++it)
+    {
+        terms_[it->second.term_id] = it;
+    }
+}
+
 void SearchServer::RemoveDocument(int document_id)
 {
 
@@ -129,130 +310,239 @@ void SearchServer::RemoveDocument(const std::execution::sequenced_policy &, int
     {
         return;
     }
-    std::for_each(
-        std::execution::seq,
-        documents_.at(document_id).word_f.begin(),
-        documents_.at(document_id).word_f.end(),
-        [this, document_id](const auto &m)
+    for (const TermId term_id : documents_.at(document_id).term_ids)
+    {
+        WordPostings &postings = terms_[term_id]->second;
+        postings.document_freqs.erase(document_id);
+        if (postings.document_freqs.empty())
         {
-            word_to_document_freqs_[m.first].erase(document_id);
-        });
-    document_to_word_freqs_.erase(document_id);
+            ReleaseTerm(term_id);
+        }
+        else
+        {
+            UpdateWordStatistics(postings);
+        }
+    }
+    columns_.Remove(documents_.at(document_id).slot);
     documents_.erase(document_id);
     document_ids_.erase(document_id);
+    OnDocumentsChanged();
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy &, int document_id)
 {
+    // Слова документа различны, поэтому каждая задача меняет свой posting-лист,
+    // а сам словарь индекса только читается
     if (documents_.count(document_id) == 0)
     {
         return;
     }
+    const auto &term_ids = documents_.at(document_id).term_ids;
     std::for_each(
         std::execution::par,
-        documents_.at(document_id).word_f.begin(),
-        documents_.at(document_id).word_f.end(),
-        [this, document_id](const auto &m)
+        term_ids.begin(), term_ids.end(),
+        [this, document_id](TermId term_id)
         {
-            word_to_document_freqs_[m.first].erase(document_id);
+            auto &postings = terms_[term_id]->second;
+            postings.document_freqs.erase(document_id);
+            UpdateWordStatistics(postings);
         });
-    document_to_word_freqs_.erase(document_id);
+    for (const TermId term_id : term_ids)
+    {
+        if (terms_[term_id]->second.document_freqs.empty())
+        {
+            ReleaseTerm(term_id);
+        }
+    }
+    columns_.Remove(documents_.at(document_id).slot);
     documents_.erase(document_id);
     document_ids_.erase(document_id);
+    OnDocumentsChanged();
 }
 
-int SearchServer::GetDocumentCount() const
+void SearchServer::RemoveDocument(const search_execution::automatic_policy &, int document_id)
 {
-    return documents_.size();
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end())
+    {
+        return;
+    }
+    execution_planner_.Run(it->second.term_ids.size() * REMOVE_WORD_WORK, [this, document_id](const auto &policy)
+                           { RemoveDocument(policy, document_id); });
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+void SearchServer::RemoveDocuments(const std::vector<int> &document_ids)
 {
+    RemoveDocumentsImpl(std::execution::par, document_ids);
+}
 
-    return SearchServer::MatchDocument(std::execution::seq, raw_query, document_id);
+void SearchServer::RemoveDocuments(const std::execution::sequenced_policy &, const std::vector<int> &document_ids)
+{
+    RemoveDocumentsImpl(std::execution::seq, document_ids);
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy &, const std::string_view raw_query, int document_id) const
+void SearchServer::RemoveDocuments(const std::execution::parallel_policy &, const std::vector<int> &document_ids)
 {
-    if (!document_ids_.count(document_id))
+    RemoveDocumentsImpl(std::execution::par, document_ids);
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocumentsImpl(ExecutionPolicy &&policy, const std::vector<int> &document_ids)
+{
+    // Пары (слово, документ), сгруппированные по слову: каждый posting-лист
+    // изменяет ровно одна задача, поэтому параллельная обработка безопасна
+    std::vector<int> removed_ids(document_ids);
+    std::sort(policy, removed_ids.begin(), removed_ids.end());
+    removed_ids.erase(std::unique(removed_ids.begin(), removed_ids.end()), removed_ids.end());
+    removed_ids.erase(std::remove_if(removed_ids.begin(), removed_ids.end(), [this](int document_id)
+                                     { return documents_.count(document_id) == 0; }),
+                      removed_ids.end());
+    if (removed_ids.empty())
     {
-        using namespace std::string_literals;
-        throw std::out_of_range(" Sqe out of range"s);
+        return;
     }
 
-    const auto query = ParseQuery(std::execution::seq, raw_query);
-
-    auto status = documents_.at(document_id).status;
-
-    std::vector<std::string_view> matched_words;
-
-    for (const std::string_view word : query.minus_words)
+    std::vector<std::pair<TermId, int>> deletions;
+    for (const int document_id : removed_ids)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        for (const TermId term_id : documents_.at(document_id).term_ids)
         {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id))
-        {
-            return {matched_words, status};
+            deletions.emplace_back(term_id, document_id);
         }
     }
+    std::sort(policy, deletions.begin(), deletions.end());
 
-    for (const std::string_view word : query.plus_words)
+    std::vector<std::pair<size_t, size_t>> groups;
+    for (size_t begin = 0, end = 0; begin < deletions.size(); begin = end)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        while (end < deletions.size() && deletions[end].first == deletions[begin].first)
         {
-            continue;
+            ++end;
         }
-        if (word_to_document_freqs_.at(word).count(document_id))
+        groups.emplace_back(begin, end);
+    }
+    std::for_each(policy,
+                  groups.begin(), groups.end(),
+                  [this, &deletions](const auto &group)
+                  {
+                      auto &postings = terms_[deletions[group.first].first]->second;
+                      for (size_t i = group.first; i < group.second; ++i)
+                      {
+                          postings.document_freqs.erase(deletions[i].second);
+                      }
+                      UpdateWordStatistics(postings);
+                  });
+
+    // Слова без документов удаляются из индекса; ссылки на них остались только у удаляемых документов
+    for (const auto &group : groups)
+    {
+        const TermId term_id = deletions[group.first].first;
+        if (terms_[term_id]->second.document_freqs.empty())
         {
-            matched_words.push_back(word);
+            ReleaseTerm(term_id);
         }
     }
+    for (const int document_id : removed_ids)
+    {
+        columns_.Remove(documents_.at(document_id).slot);
+        documents_.erase(document_id);
+        document_ids_.erase(document_id);
+    }
+    OnDocumentsChanged();
+}
 
-    return {matched_words, documents_.at(document_id).status};
+int SearchServer::GetDocumentCount() const
+{
+    return documents_.size();
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy &, const std::string_view raw_query, int document_id) const
+DocumentStatus SearchServer::GetDocumentStatus(int document_id) const
 {
-    if (!document_ids_.count(document_id))
+    using std::string_literals::operator""s;
+
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end())
     {
-        using namespace std::string_literals;
-        throw std::out_of_range("Par out of range"s);
+        throw std::out_of_range("Unknown document id"s);
     }
+    return columns_.GetStatus(it->second.slot);
+}
 
-    const auto query = ParseQuery(std::execution::par, raw_query);
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+{
 
-    const auto status = documents_.at(document_id).status;
+    return SearchServer::MatchDocument(std::execution::seq, raw_query, document_id);
+}
 
-    const auto word_checker = [this, document_id](const std::string_view word)
-    {
-        const auto it = word_to_document_freqs_.find(word);
-        return it != word_to_document_freqs_.end() && it->second.count(document_id);
-    };
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy &, const std::string_view raw_query, int document_id) const
+{
+    return ValueOrThrow(TryMatchDocument(std::execution::seq, raw_query, document_id));
+}
 
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker))
-    {
-        std::vector<std::string_view> m;
-        return {m, status};
-    }
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy &, const std::string_view raw_query, int document_id) const
+{
+    return ValueOrThrow(TryMatchDocument(std::execution::par, raw_query, document_id));
+}
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto words_end = std::copy_if(
-        std::execution::par,
-        query.plus_words.begin(), query.plus_words.end(),
-        matched_words.begin(),
-        word_checker);
-    std::sort(std::execution::par, matched_words.begin(), words_end);
-    words_end = std::unique(std::execution::par, matched_words.begin(), words_end);
-    matched_words.erase(words_end, matched_words.end());
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const search_execution::automatic_policy &, const std::string_view raw_query, int document_id) const
+{
+    return ValueOrThrow(TryMatchDocument(search_execution::automatic, raw_query, document_id));
+}
 
-    return {matched_words, status};
+SearchOutcome<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::TryMatchDocument(const std::string_view raw_query, int document_id) const
+{
+    return TryMatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+SearchOutcome<std::vector<Document>> SearchServer::TryFindTopDocuments(const std::string_view raw_query) const
+{
+    return TryFindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+void SearchServer::SetExecutionCostModel(const ExecutionCostModel &model)
+{
+    execution_planner_.SetCostModel(model);
+}
+
+const ExecutionCostModel &SearchServer::GetExecutionCostModel() const
+{
+    return execution_planner_.GetCostModel();
+}
+
+ExecutionPlan SearchServer::PlanFindTopDocuments(const std::string_view raw_query) const
+{
+    return execution_planner_.Plan(EstimateSearchWork(ParseQuery(std::execution::seq, raw_query)));
+}
+
+ExecutionStats SearchServer::GetExecutionStats() const
+{
+    return execution_planner_.GetStats();
+}
+
+void SearchServer::ResetExecutionStats()
+{
+    execution_planner_.ResetStats();
+}
+
+std::vector<std::string_view> SearchServer::MatchTerms(const TermQuery &query, const DocumentData &document_data) const
+{
+    std::vector<std::string_view> matched_words;
+    if (HasCommonTerm(query.minus_terms, document_data.term_ids))
+    {
+        return matched_words;
+    }
+    // Слова берутся из индекса: нормализованный запрос не переживает MatchDocument
+    IntersectTerms(query.plus_terms, document_data.term_ids, [this, &query, &matched_words](size_t query_index, size_t)
+                   {
+                       matched_words.push_back(terms_[query.plus_terms[query_index]]->first);
+                       return true; });
+    std::sort(matched_words.begin(), matched_words.end());
+    return matched_words;
 }
 
 bool SearchServer::IsStopWord(const std::string_view word) const
 {
-    return stop_words_.count(word) > 0;
+    return stop_word_set_.Contains(word);
 }
 
 bool SearchServer::IsValidWord(const std::string_view word)
@@ -262,23 +552,37 @@ bool SearchServer::IsValidWord(const std::string_view word)
                         { return c >= '\0' && c < ' '; });
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const
+SearchServer::WordError SearchServer::SplitIntoWordsNoStop(const std::string_view text, std::string &storage, std::vector<std::string_view> &words) const
 {
-    using std::string_literals::operator""s;
-
-    std::vector<std::string_view> words;
-    for (const std::string_view word : SplitIntoWords({text}))
+    size_t invalid_index = 0;
+    if (analyzer_)
     {
-        if (!IsValidWord(word))
-        {
-            throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
-        }
-        if (!IsStopWord(word))
-        {
-            words.push_back(word);
-        }
+        // Нормализация и разбиение за один проход, прямо в хранилище документа
+        invalid_index = analyzer_->Analyze(text, storage, words);
     }
-    return words;
+    else
+    {
+        storage.assign(text);
+        invalid_index = SplitIntoWords(storage, words);
+    }
+    if (invalid_index < words.size())
+    {
+        return {SearchError::INVALID_WORD, words[invalid_index]};
+    }
+    words.erase(std::remove_if(words.begin(), words.end(), [this](const std::string_view word)
+                               { return IsStopWord(word); }),
+                words.end());
+    return {};
+}
+
+bool SearchServer::HasCommonTerm(const std::vector<TermId> &lhs, const std::vector<TermId> &rhs)
+{
+    bool found = false;
+    IntersectTerms(lhs, rhs, [&found](size_t, size_t)
+                   {
+                       found = true;
+                       return false; });
+    return found;
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int> &ratings)
@@ -292,13 +596,11 @@ int SearchServer::ComputeAverageRating(const std::vector<int> &ratings)
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word) const
+SearchError SearchServer::ParseQueryWord(std::string_view word, QueryWord &query_word) const
 {
-    using std::string_literals::operator""s;
-
     if (word.empty())
     {
-        throw std::invalid_argument("Query word is empty"s);
+        return SearchError::EMPTY_WORD;
     }
     bool is_minus = false;
     if (word[0] == '-')
@@ -306,52 +608,66 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word) cons
         is_minus = true;
         word.remove_prefix(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word))
+    // Управляющие символы отсеивает токенизатор в ParseQuery
+    if (word.empty() || word[0] == '-')
     {
-        throw std::invalid_argument("Query word "s + std::string(word) + " is invalid");
+        return SearchError::INVALID_MINUS_WORD;
     }
-    return {word, is_minus, IsStopWord(word)};
+    query_word = {word, is_minus, IsStopWord(word)};
+    return SearchError::NONE;
 }
 
 SearchServer::Query SearchServer::ParseQuery(const std::execution::sequenced_policy &, const std::string_view text) const
 {
     Query result;
-    for (const std::string_view word : SplitIntoWords(text))
+    const WordError parse_error = TryParseQuery(std::execution::seq, text, result);
+    if (parse_error.error != SearchError::NONE)
     {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop)
-        {
-            if (query_word.is_minus)
-            {
-                result.minus_words.insert(query_word.data);
-            }
-            else
-            {
-                result.plus_words.insert(query_word.data);
-            }
-        }
+        ThrowSearchError(parse_error.error, parse_error.word);
     }
-
     return result;
 }
 
 SearchServer::ParQuery SearchServer::ParseQuery(const std::execution::parallel_policy &, const std::string_view text) const
 {
     ParQuery result;
-    for (const std::string_view word : SplitIntoWords(text))
+    const WordError parse_error = TryParseQuery(std::execution::par, text, result);
+    if (parse_error.error != SearchError::NONE)
     {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop)
-        {
-            if (query_word.is_minus)
-            {
-                result.minus_words.push_back(query_word.data);
-            }
-            else
-            {
-                result.plus_words.push_back(query_word.data);
-            }
-        }
+        ThrowSearchError(parse_error.error, parse_error.word);
+    }
+    return result;
+}
+
+SearchServer::WordError SearchServer::TryParseQuery(const std::execution::sequenced_policy &, const std::string_view text, Query &result) const
+{
+    return ParseQueryWords(text, result.normalized_text, [&result](const std::string_view word, bool is_minus)
+                    {
+                        if (is_minus)
+                        {
+                            result.minus_words.insert(word);
+                        }
+                        else
+                        {
+                            result.plus_words.insert(word);
+                        } });
+}
+
+SearchServer::WordError SearchServer::TryParseQuery(const std::execution::parallel_policy &, const std::string_view text, ParQuery &result) const
+{
+    const WordError parse_error = ParseQueryWords(text, result.normalized_text, [&result](const std::string_view word, bool is_minus)
+                    {
+                        if (is_minus)
+                        {
+                            result.minus_words.push_back(word);
+                        }
+                        else
+                        {
+                            result.plus_words.push_back(word);
+                        } });
+    if (parse_error.error != SearchError::NONE)
+    {
+        return parse_error;
     }
     std::sort(std::execution::par, result.minus_words.begin(), result.minus_words.end());
     auto last = std::unique(std::execution::par, result.minus_words.begin(), result.minus_words.end());
@@ -360,13 +676,267 @@ SearchServer::ParQuery SearchServer::ParseQuery(const std::execution::parallel_p
     std::sort(std::execution::par, result.plus_words.begin(), result.plus_words.end());
     last = std::unique(std::execution::par, result.plus_words.begin(), result.plus_words.end());
     result.plus_words.erase(last, result.plus_words.end());
+    return {};
+}
 
+void SearchServer::ThrowSearchError(SearchError error, std::string_view word)
+{
+    using std::string_literals::operator""s;
+
+    switch (error)
+    {
+    case SearchError::INVALID_WORD:
+    case SearchError::INVALID_MINUS_WORD:
+        throw std::invalid_argument("Query word "s + std::string(word) + " is invalid"s);
+    case SearchError::UNKNOWN_DOCUMENT:
+        throw std::out_of_range("Unknown document id"s);
+    default:
+        throw std::invalid_argument(std::string(GetSearchErrorMessage(error)));
+    }
+}
+
+std::string_view GetSearchErrorMessage(SearchError error)
+{
+    using std::string_view_literals::operator""sv;
+
+    switch (error)
+    {
+    case SearchError::NONE:
+        return "No error"sv;
+    case SearchError::INVALID_WORD:
+        return "Query word contains control characters"sv;
+    case SearchError::EMPTY_WORD:
+        return "Query word is empty"sv;
+    case SearchError::INVALID_MINUS_WORD:
+        return "Minus word is empty or starts with two minuses"sv;
+    case SearchError::UNKNOWN_DOCUMENT:
+        return "Unknown document id"sv;
+    }
+    return "Unknown error"sv;
+}
+
+std::map<std::string, int, std::less<>> SearchServer::GetQueryDocumentFreqs(const std::string_view raw_query) const
+{
+    const Query query = ParseQuery(std::execution::seq, raw_query);
+    std::map<std::string, int, std::less<>> result;
+    for (const std::string_view word : query.plus_words)
+    {
+        const auto it = word_to_document_freqs_.find(word);
+        result.emplace(word, it == word_to_document_freqs_.end() ? 0 : static_cast<int>(it->second.document_freqs.size()));
+    }
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const
+double SearchServer::ComputeWordInverseDocumentFreq(const WordPostings &postings) const
+{
+    return log_document_count_ - postings.log_document_freq;
+}
+
+void SearchServer::UpdateWordStatistics(WordPostings &postings)
+{
+    if (!postings.document_freqs.empty())
+    {
+        postings.log_document_freq = std::log(static_cast<double>(postings.document_freqs.size()));
+    }
+}
+
+void SearchServer::OnDocumentsChanged()
 {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+    log_document_count_ = documents_.empty() ? 0.0 : std::log(static_cast<double>(documents_.size()));
+    if (impact_precision_ != ImpactPrecision::NONE)
+    {
+        PrecomputeImpacts(ImpactPrecision::NONE);
+    }
+    ResetStaticRank();
+}
+
+void SearchServer::ResetStaticRank()
+{
+    if (!ordered_by_static_rank_)
+    {
+        return;
+    }
+    for (auto &[word, postings] : word_to_document_freqs_)
+    {
+        postings.ranked_postings = {};
+    }
+    ordered_by_static_rank_ = false;
+}
+
+void SearchServer::RenumberSlots(const std::vector<DocumentColumns::Slot> &order)
+{
+    const std::vector<DocumentColumns::Slot> new_slots = columns_.Renumber(order);
+    for (auto &[document_id, document_data] : documents_)
+    {
+        document_data.slot = new_slots[document_data.slot];
+    }
+    std::for_each(std::execution::par,
+                  word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                  [&new_slots](auto &word_postings)
+                  {
+                      WordPostings &postings = word_postings.second;
+                      for (auto &[document_id, posting] : postings.document_freqs)
+                      {
+                          posting.slot = new_slots[posting.slot];
+                      }
+                  });
+    ResetStaticRank();
+    if (impact_precision_ != ImpactPrecision::NONE)
+    {
+        PrecomputeImpacts(impact_precision_);
+    }
+}
+
+void SearchServer::PrecomputeImpacts(ImpactPrecision precision)
+{
+    // Шаг квантования определяется максимальным весом во всём индексе
+    double max_impact = 0.0;
+    if (precision == ImpactPrecision::UINT16 || precision == ImpactPrecision::UINT8)
+    {
+        for (const auto &[word, postings] : word_to_document_freqs_)
+        {
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(postings);
+            for (const auto &[document_id, posting] : postings.document_freqs)
+            {
+                max_impact = std::max(max_impact, posting.term_freq * inverse_document_freq);
+            }
+        }
+    }
+    const double max_level = precision == ImpactPrecision::UINT16 ? 65535.0 : 255.0;
+    impact_quantum_ = max_impact > 0.0 ? max_impact / max_level : 1.0;
+
+    std::for_each(std::execution::par,
+                  word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                  [this, precision](auto &word_postings)
+                  {
+                      WordPostings &postings = word_postings.second;
+                      postings.impact_slots = {};
+                      postings.impacts = {};
+                      postings.impacts16 = {};
+                      postings.impacts8 = {};
+                      if (precision == ImpactPrecision::NONE)
+                      {
+                          return;
+                      }
+                      const double inverse_document_freq = ComputeWordInverseDocumentFreq(postings);
+                      // По возрастанию слота: после ReorderDocuments соседние записи читают соседние столбцы
+                      std::vector<Posting> sorted_postings;
+                      sorted_postings.reserve(postings.document_freqs.size());
+                      for (const auto &[document_id, posting] : postings.document_freqs)
+                      {
+                          sorted_postings.push_back(posting);
+                      }
+                      std::sort(sorted_postings.begin(), sorted_postings.end(), [](const Posting &lhs, const Posting &rhs)
+                                { return lhs.slot < rhs.slot; });
+                      postings.impact_slots.reserve(sorted_postings.size());
+                      for (const Posting &posting : sorted_postings)
+                      {
+                          const double impact = posting.term_freq * inverse_document_freq;
+                          postings.impact_slots.push_back(posting.slot);
+                          switch (precision)
+                          {
+                          case ImpactPrecision::DOUBLE:
+                              postings.impacts.push_back(impact);
+                              break;
+                          case ImpactPrecision::UINT16:
+                              postings.impacts16.push_back(static_cast<uint16_t>(std::lround(impact / impact_quantum_)));
+                              break;
+                          case ImpactPrecision::UINT8:
+                              postings.impacts8.push_back(static_cast<uint8_t>(std::lround(impact / impact_quantum_)));
+                              break;
+                          case ImpactPrecision::NONE:
+                              break;
+                          }
+                      }
+                  });
+    impact_precision_ = precision;
+}
+
+bool SearchServer::HasPrecomputedImpacts() const
+{
+    return impact_precision_ != ImpactPrecision::NONE;
+}
+
+ImpactPrecision SearchServer::GetImpactPrecision() const
+{
+    return impact_precision_;
+}
+
+void SearchServer::OrderByStaticRank()
+{
+    // documents_ перебирается по возрастанию id, устойчивая сортировка сохраняет его при равном рейтинге
+    std::vector<DocumentColumns::Slot> order;
+    order.reserve(documents_.size());
+    for (const auto &[document_id, document_data] : documents_)
+    {
+        order.push_back(document_data.slot);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](DocumentColumns::Slot lhs, DocumentColumns::Slot rhs)
+                     { return columns_.GetRating(lhs) > columns_.GetRating(rhs); });
+    RenumberSlots(order);
+
+    std::for_each(std::execution::par,
+                  word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                  [](auto &word_postings)
+                  {
+                      WordPostings &postings = word_postings.second;
+                      postings.ranked_postings.clear();
+                      postings.ranked_postings.reserve(postings.document_freqs.size());
+                      for (const auto &[document_id, posting] : postings.document_freqs)
+                      {
+                          postings.ranked_postings.push_back(posting);
+                      }
+                      std::sort(postings.ranked_postings.begin(), postings.ranked_postings.end(), [](const Posting &lhs, const Posting &rhs)
+                                { return lhs.slot < rhs.slot; });
+                  });
+    ordered_by_static_rank_ = true;
+}
+
+bool SearchServer::IsOrderedByStaticRank() const
+{
+    return ordered_by_static_rank_;
+}
+
+std::vector<int> SearchServer::GetDocumentOrder() const
+{
+    std::vector<std::pair<DocumentColumns::Slot, int>> slots;
+    slots.reserve(documents_.size());
+    for (const auto &[document_id, document_data] : documents_)
+    {
+        slots.emplace_back(document_data.slot, document_id);
+    }
+    std::sort(slots.begin(), slots.end());
+    std::vector<int> result;
+    result.reserve(slots.size());
+    for (const auto &[slot, document_id] : slots)
+    {
+        result.push_back(document_id);
+    }
+    return result;
+}
+
+void SearchServer::ReorderDocuments(const std::vector<int> &document_ids)
+{
+    using std::string_literals::operator""s;
+
+    std::vector<DocumentColumns::Slot> order;
+    order.reserve(document_ids.size());
+    std::vector<bool> listed(columns_.GetSlotCount(), false);
+    for (const int document_id : document_ids)
+    {
+        const auto it = documents_.find(document_id);
+        if (it == documents_.end() || listed[it->second.slot])
+        {
+            throw std::invalid_argument("Document order must list every document exactly once"s);
+        }
+        listed[it->second.slot] = true;
+        order.push_back(it->second.slot);
+    }
+    if (order.size() != documents_.size())
+    {
+        throw std::invalid_argument("Document order must list every document exactly once"s);
+    }
+    RenumberSlots(order);
 }
 
 // Обертки по поиску
@@ -374,8 +944,7 @@ double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word)
 //старые
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
 {
-    return FindTopDocuments(std::execution::seq, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-                            { return document_status == status; });
+    return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const
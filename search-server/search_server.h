@@ -8,28 +8,158 @@
 #include <numeric>
 #include <execution>
 #include <set>
+#include <optional>
+#include <limits>
+#include <chrono>
 #include "string_processing.h"
+#include "text_analyzer.h"
+#include "stop_word_set.h"
 #include "document.h"
+#include "document_columns.h"
+#include "document_filter.h"
 #include "log_duration.h"
 #include "concurrent_map.h"
+#include "execution_planner.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EPSILON = 1e-6;
 
+// Порядок выдачи по релевантности: при равной с точностью EPSILON — по убыванию рейтинга,
+// затем по возрастанию id. Последнее правило делает выдачу независимой от порядка обхода
+// индекса (слотов, перенумерации, шардов)
+inline bool IsRankedBefore(const Document &lhs, const Document &rhs)
+{
+    if (std::abs(lhs.relevance - rhs.relevance) >= EPSILON)
+    {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating)
+    {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+// Представление заранее посчитанных весов TF * IDF в индексе
+enum class ImpactPrecision
+{
+    NONE,
+    DOUBLE,
+    UINT16,
+    UINT8,
+};
+
+// Строка массового сопоставления: слова запроса, найденные в документе, по алфавиту.
+// Слова ссылаются на ключи индекса и действительны, пока слово есть в индексе
+struct MatchedDocument
+{
+    int id = 0;
+    std::vector<std::string_view> words;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+};
+
+// Порядок выдачи FindTopDocuments
+enum class ResultOrder
+{
+    RELEVANCE,
+    // По убыванию рейтинга, при равном рейтинге — по убыванию релевантности
+    RATING,
+};
+
+// Ограничение работы одного запроса FindTopDocuments
+struct SearchBudget
+{
+    // После срока следующее слово запроса не обрабатывается
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    // Записи posting-листов плюс-слов; слово, которое не помещается в остаток целиком,
+    // не обрабатывается. 0 — без ограничения
+    size_t max_postings = 0;
+};
+
+// Выдача поиска с бюджетом
+struct BudgetedSearchResult
+{
+    std::vector<Document> documents;
+    // Бюджет кончился раньше слов запроса: выдача — лучшие документы по обработанным,
+    // самым редким словам
+    bool partial = false;
+    size_t postings_scored = 0;
+    // Необработанные плюс-слова запроса, которые есть в индексе
+    size_t skipped_words = 0;
+};
+
+// Причина отказа TryFindTopDocuments и TryMatchDocument
+enum class SearchError : uint8_t
+{
+    NONE,
+    // Слово с управляющими символами
+    INVALID_WORD,
+    EMPTY_WORD,
+    // Одиночный минус или слово, начинающееся с двух минусов
+    INVALID_MINUS_WORD,
+    UNKNOWN_DOCUMENT,
+};
+
+// Статическая строка: на пути ошибки ничего не выделяется
+std::string_view GetSearchErrorMessage(SearchError error);
+
+// Результат или ошибка без исключений: value заполнен, только если error == NONE
+template <typename T>
+struct SearchOutcome
+{
+    T value{};
+    SearchError error = SearchError::NONE;
+    // Слово, в котором найдена ошибка разбора; ссылается на текст запроса
+    std::string_view word;
+
+    explicit operator bool() const
+    {
+        return error == SearchError::NONE;
+    }
+};
+
+// IDF нормализованных слов, посчитанные по всей коллекции, когда сервер хранит только её часть
+using InverseDocumentFreqs = std::map<std::string, double, std::less<>>;
+
 class SearchServer
 {
 
 public:
+    // Id слова в индексе: постоянен, пока слово встречается хотя бы в одном документе,
+    // после удаления слова может быть выдан другому
+    using TermId = uint32_t;
+
     template <typename StringContainer>
     explicit SearchServer(const StringContainer &stop_words);
     explicit SearchServer(const std::string &stop_words_text);
     explicit SearchServer(const std::string_view stop_words_text);
+    // С анализатором документы, запросы и стоп-слова проходят одну и ту же нормализацию
+    template <typename StringContainer>
+    SearchServer(const StringContainer &stop_words, const TextAnalyzer &analyzer);
+    SearchServer(const std::string &stop_words_text, const TextAnalyzer &analyzer);
+    SearchServer(const std::string_view stop_words_text, const TextAnalyzer &analyzer);
+    // terms_ хранит итераторы word_to_document_freqs_, поэтому копия и перемещённый
+    // сервер пересобирают его по своему индексу
+    SearchServer(const SearchServer &other);
+    SearchServer(SearchServer &&other) noexcept;
+    SearchServer &operator=(const SearchServer &other);
+    SearchServer &operator=(SearchServer &&other) noexcept;
     std::set<int>::const_iterator begin() const;
     std::set<int>::const_iterator end() const;
-    const std::map<std::string_view, double> &GetWordFrequencies(int document_id) const;
+    // Собирается из прямого индекса при каждом вызове
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+    // Прямой индекс документа: id его слов по возрастанию (пустой вектор, если документа нет)
+    const std::vector<TermId> &GetDocumentTermIds(int document_id) const;
+    std::string_view GetTermWord(TermId term_id) const;
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::sequenced_policy &, int document_id);
     void RemoveDocument(const std::execution::parallel_policy &, int document_id);
+    void RemoveDocument(const search_execution::automatic_policy &, int document_id);
+    // Удаление пачки документов; несуществующие id пропускаются. Удаления группируются
+    // по словам, и posting-листы разных слов обрабатываются параллельно
+    void RemoveDocuments(const std::vector<int> &document_ids);
+    void RemoveDocuments(const std::execution::sequenced_policy &, const std::vector<int> &document_ids);
+    void RemoveDocuments(const std::execution::parallel_policy &, const std::vector<int> &document_ids);
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
 
     template <typename DocumentPredicate>
@@ -46,32 +176,180 @@ public:
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentStatus status) const;
 
+    // В порядке RATING документы перебираются по индексу рейтингов от лучших, и перебор
+    // останавливается, когда набрано MAX_RESULT_DOCUMENT_COUNT документов и рейтинг сменился.
+    // Если перебор затягивается (редкие слова или много документов с одним рейтингом),
+    // документы запроса оцениваются целиком, как в порядке RELEVANCE.
+    // После OrderByStaticRank вместо индекса рейтингов сливаются posting-листы слов запроса:
+    // читаются только их начала, и запасной полный подсчёт не нужен.
+    // Релевантность в этом порядке всегда точная, без заранее посчитанных весов
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate, ResultOrder order) const;
+
+    // Поиск и сопоставление без исключений: некорректный запрос или неизвестный документ
+    // возвращают код ошибки, и разбор плохого запроса стоит не дороже хорошего.
+    // FindTopDocuments и MatchDocument — обёртки, бросающие исключение по коду
+    SearchOutcome<std::vector<Document>> TryFindTopDocuments(const std::string_view raw_query) const;
+    template <typename DocumentPredicate>
+    SearchOutcome<std::vector<Document>> TryFindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchOutcome<std::vector<Document>> TryFindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    SearchOutcome<std::tuple<std::vector<std::string_view>, DocumentStatus>> TryMatchDocument(const std::string_view raw_query, int document_id) const;
+    template <typename ExecutionPolicy>
+    SearchOutcome<std::tuple<std::vector<std::string_view>, DocumentStatus>> TryMatchDocument(ExecutionPolicy &&policy, const std::string_view raw_query, int document_id) const;
+
+    // Для коллекции, разбитой на несколько серверов (ShardedSearchServer): нормализованные
+    // плюс-слова запроса и число документов этого сервера с каждым из них
+    std::map<std::string, int, std::less<>> GetQueryDocumentFreqs(const std::string_view raw_query) const;
+    // Поиск с IDF плюс-слов из inverse_document_freqs вместо статистики этого сервера;
+    // слова, которых там нет, релевантности не добавляют. Заранее посчитанные веса не используются
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate, const InverseDocumentFreqs &inverse_document_freqs) const;
+
+    // Поиск с ограничением по времени или по числу записей posting-листов. Плюс-слова
+    // обрабатываются от самых редких: у них наибольший IDF, и при исчерпании бюджета
+    // пропускаются частые слова, меньше всего влияющие на релевантность. Минус-слова
+    // применяются всегда. Срок проверяется между словами, поэтому превышается не больше чем
+    // на обработку одного posting-листа. Релевантность точная, без заранее посчитанных весов
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    BudgetedSearchResult FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate, const SearchBudget &budget) const;
+
     int GetDocumentCount() const;
+
+    // Сворачивает TF и IDF в один вес на каждую запись индекса: поиск сводится к сложениям.
+    // Веса действительны до следующего добавления или удаления документа, после чего
+    // сбрасываются, и поиск возвращается к TF * IDF из кэша log(df).
+    // UINT16 и UINT8 хранят веса, квантованные с шагом q = (максимальный вес) / 65535 или / 255,
+    // и суммируют их в целых числах. Релевантность документа отличается от точной
+    // не более чем на (число слов запроса) * q / 2
+    void PrecomputeImpacts(ImpactPrecision precision = ImpactPrecision::DOUBLE);
+    bool HasPrecomputedImpacts() const;
+    ImpactPrecision GetImpactPrecision() const;
+    // Перенумеровывает слоты документов по убыванию рейтинга (статического ранга, при равном —
+    // по возрастанию id) и раскладывает posting-листы в порядке слотов, так что лучшие
+    // документы каждого слова идут первыми. Заранее посчитанные веса сохраняются.
+    // Порядок действителен до следующего добавления или удаления документа
+    void OrderByStaticRank();
+    bool IsOrderedByStaticRank() const;
+    // Документы в порядке внутренних номеров (слотов)
+    std::vector<int> GetDocumentOrder() const;
+    // Перенумеровывает слоты документов в порядке document_ids, например по ComputeBisectionOrder:
+    // похожие документы получают близкие слоты. document_ids должен перечислять каждый документ
+    // ровно один раз. Внешние id документов не меняются; порядок OrderByStaticRank сбрасывается
+    void ReorderDocuments(const std::vector<int> &document_ids);
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy &, const std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy &, const std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const search_execution::automatic_policy &, const std::string_view raw_query, int document_id) const;
+
+    // Сопоставляет запрос со всеми документами за один разбор запроса, обходя posting-листы
+    // его слов, а не документы. Строки возвращаются по возрастанию id только для документов
+    // с плюс-словами запроса, без минус-слов и прошедших предикат
+    template <typename DocumentPredicate>
+    std::vector<MatchedDocument> MatchAllDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<MatchedDocument> MatchAllDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    // То же без накопления результата: callback(const MatchedDocument &) вызывается
+    // последовательно по возрастанию id, строка переиспользуется между вызовами
+    template <typename DocumentPredicate, typename Callback>
+    void ForEachMatchedDocument(const std::string_view raw_query, DocumentPredicate document_predicate, Callback callback) const;
+
+    DocumentStatus GetDocumentStatus(int document_id) const;
+
+    // Политика search_execution::automatic в FindTopDocuments, MatchDocument и RemoveDocument
+    // выбирает seq или par и число потоков по оценке работы вызова: записи posting-листов
+    // плюс- и минус-слов запроса, слова удаляемого документа, слова запроса и документа
+    // при сопоставлении. Модель меняется только между вызовами
+    void SetExecutionCostModel(const ExecutionCostModel &model);
+    const ExecutionCostModel &GetExecutionCostModel() const;
+    // Решение, которое automatic примет для запроса FindTopDocuments, без выполнения поиска
+    ExecutionPlan PlanFindTopDocuments(const std::string_view raw_query) const;
+    // Решения automatic с момента создания сервера или ResetExecutionStats
+    ExecutionStats GetExecutionStats() const;
+    void ResetExecutionStats();
 
 private:
+    // Рейтинг и статус хранятся в столбцах columns_ по слоту документа
     struct DocumentData
     {
-        int rating;
-        DocumentStatus status;
-        std::string data_str;
-        std::map<std::string_view, double> word_f;
+        DocumentColumns::Slot slot;
+        // Прямой индекс: id слов по возрастанию и TF с теми же индексами
+        std::vector<TermId> term_ids;
+        std::vector<double> term_freqs;
     };
 
+    std::optional<TextAnalyzer> analyzer_;
     std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
+    StopWordSet stop_word_set_;
+    // Запись posting-листа: TF слова в документе и слот документа в столбцах атрибутов
+    struct Posting
+    {
+        double term_freq;
+        DocumentColumns::Slot slot;
+    };
+
+    struct WordPostings
+    {
+        TermId term_id = 0;
+        std::map<int, Posting> document_freqs;
+        // log(df) пересчитывается при изменении document_freqs,
+        // IDF слова = log_document_count_ - log_document_freq
+        double log_document_freq = 0.0;
+        // Веса TF * IDF, заполняются PrecomputeImpacts: слоты документов по возрастанию
+        // и веса с теми же индексами в одном из массивов в зависимости от точности
+        std::vector<DocumentColumns::Slot> impact_slots;
+        std::vector<double> impacts;
+        std::vector<uint16_t> impacts16;
+        std::vector<uint8_t> impacts8;
+        // Записи по возрастанию слота, заполняются OrderByStaticRank
+        std::vector<Posting> ranked_postings;
+    };
+
+    // Индекс владеет строками слов, остальные структуры ссылаются на его ключи.
+    // Слово удаляется из индекса вместе с последним содержащим его документом
+    using TermIndex = std::map<std::string, WordPostings, std::less<>>;
+    TermIndex word_to_document_freqs_;
+    // Записи индекса по id слова; освобождённые id указывают на end() и лежат в free_term_ids_
+    std::vector<TermIndex::iterator> terms_;
+    std::vector<TermId> free_term_ids_;
+    double log_document_count_ = 0.0;
+    ImpactPrecision impact_precision_ = ImpactPrecision::NONE;
+    // Вес, соответствующий единице квантованного значения
+    double impact_quantum_ = 1.0;
+    bool ordered_by_static_rank_ = false;
     std::map<int, DocumentData> documents_;
+    DocumentColumns columns_;
     std::set<int> document_ids_;
+    ExecutionPlanner execution_planner_;
+    // Цена в записях posting-листов для ExecutionPlanner: удаление документа из posting-листа
+    // одного слова (поиск и удаление в std::map) и байт запроса при разборе
+    static constexpr size_t REMOVE_WORD_WORK = 8;
+    static constexpr size_t PARSE_BYTE_WORK = 1;
 
     bool IsStopWord(const std::string_view word) const;
     static bool IsValidWord(const std::string_view word);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
+    // Ошибка разбора и слово, в котором она найдена
+    struct WordError
+    {
+        SearchError error = SearchError::NONE;
+        std::string_view word;
+    };
+
+    // Копирует текст документа в storage (нормализуя его, если задан анализатор)
+    // и разбивает на слова без стоп-слов; words — переиспользуемый буфер
+    WordError SplitIntoWordsNoStop(const std::string_view text, std::string &storage, std::vector<std::string_view> &words) const;
 
     static int ComputeAverageRating(const std::vector<int> &ratings);
+
+    template <typename ExecutionPolicy>
+    void RemoveDocumentsImpl(ExecutionPolicy &&policy, const std::vector<int> &document_ids);
+
+    TermIndex::iterator GetOrCreateTerm(const std::string_view word);
+    // Удаляет из индекса слово, не встречающееся больше ни в одном документе
+    void ReleaseTerm(TermId term_id);
+    // Направляет terms_ на записи word_to_document_freqs_ этого сервера по их term_id
+    void RebuildTerms();
     struct QueryWord
     {
         std::string_view data;
@@ -79,27 +357,124 @@ private:
         bool is_stop;
     };
 
-    QueryWord ParseQueryWord(const std::string_view word) const;
+    SearchError ParseQueryWord(std::string_view word, QueryWord &query_word) const;
 
+    // Нормализованные слова запроса живут в normalized_text: вектор при перемещении
+    // сохраняет буфер, поэтому string_view остаются валидными
     struct Query
     {
 
         std::set<std::string_view> plus_words;
         std::set<std::string_view> minus_words;
+        std::vector<char> normalized_text;
+        // Внешние IDF, если заданы
+        const InverseDocumentFreqs *inverse_document_freqs = nullptr;
     };
     struct ParQuery
     {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        std::vector<char> normalized_text;
+        const InverseDocumentFreqs *inverse_document_freqs = nullptr;
     };
 
+    template <typename ExecutionPolicy>
+    using QueryFor = std::conditional_t<std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::parallel_policy>, ParQuery, Query>;
+
+    // Разбирает запрос, вызывая add_word(word, is_minus) для каждого слова не из стоп-списка.
+    // Слова проверяются до первого add_word: запрос с ошибкой ничего не добавляет
+    template <typename AddWord>
+    WordError ParseQueryWords(const std::string_view text, std::vector<char> &normalized_text, AddWord add_word) const;
+
+    WordError TryParseQuery(const std::execution::sequenced_policy &, const std::string_view text, Query &query) const;
+    WordError TryParseQuery(const std::execution::parallel_policy &, const std::string_view text, ParQuery &query) const;
+    // Бросают std::invalid_argument
     Query ParseQuery(const std::execution::sequenced_policy &, const std::string_view text) const;
     ParQuery ParseQuery(const std::execution::parallel_policy &, const std::string_view text) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    // Сообщение исключения собирается только здесь, на пути ошибки
+    [[noreturn]] static void ThrowSearchError(SearchError error, std::string_view word);
+    template <typename T>
+    static T ValueOrThrow(SearchOutcome<T> &&outcome);
+
+    // Запрос в id слов индекса, отсортированных по возрастанию; слов, которых нет в индексе, здесь нет
+    struct TermQuery
+    {
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+    };
+
+    template <typename Q>
+    TermQuery ResolveTerms(const Q &query) const;
+    // Слияние отсортированных id слов запроса с прямым индексом документа
+    std::vector<std::string_view> MatchTerms(const TermQuery &query, const DocumentData &document_data) const;
+
+    // Вызывает on_match(lhs_index, rhs_index) для общих id двух отсортированных списков,
+    // пока on_match возвращает true
+    template <typename OnMatch>
+    static void IntersectTerms(const std::vector<TermId> &lhs, const std::vector<TermId> &rhs, OnMatch on_match);
+    static bool HasCommonTerm(const std::vector<TermId> &lhs, const std::vector<TermId> &rhs);
+
+    template <typename Words>
+    size_t CountPostings(const Words &words) const;
+
+    // Пары (id документа, номер плюс-слова в words) из posting-листов запроса, отсортированные
+    // по id и номеру слова; документы с минус-словами отброшены
+    template <typename ExecutionPolicy, typename Q>
+    std::vector<std::pair<int, uint32_t>> CollectMatches(ExecutionPolicy &&policy, const Q &query, std::vector<std::string_view> &words) const;
+
+    double ComputeWordInverseDocumentFreq(const WordPostings &postings) const;
+    void UpdateWordStatistics(WordPostings &postings);
+    // Вызывается при любом изменении набора документов
+    void OnDocumentsChanged();
+    // Переставляет документы по слотам: order — занятые слоты в новом порядке.
+    // Обновляет слоты в прямом индексе и posting-листах, пересчитывает веса
+    // и сбрасывает порядок OrderByStaticRank
+    void RenumberSlots(const std::vector<DocumentColumns::Slot> &order);
+    void ResetStaticRank();
+
+    // Оценка работы поиска по разобранному запросу для ExecutionPlanner
+    template <typename Q>
+    size_t EstimateSearchWork(const Q &query) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsImpl(ExecutionPolicy &&policy, const std::string_view raw_query, const DocumentPredicate &document_predicate, const InverseDocumentFreqs *inverse_document_freqs = nullptr) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchOutcome<std::vector<Document>> TryFindTopDocumentsImpl(ExecutionPolicy &&policy, const std::string_view raw_query, const DocumentPredicate &document_predicate, const InverseDocumentFreqs *inverse_document_freqs) const;
+    // Поиск и сортировка по уже разобранному запросу
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+    std::vector<Document> FindTopDocumentsInQuery(ExecutionPolicy &&policy, const Q &query, const DocumentPredicate &document_predicate) const;
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+    BudgetedSearchResult FindTopDocumentsWithin(ExecutionPolicy &&policy, const Q &query, const DocumentPredicate &document_predicate, const SearchBudget &budget) const;
+    // Сортирует по релевантности и оставляет MAX_RESULT_DOCUMENT_COUNT лучших
+    template <typename ExecutionPolicy>
+    static void SelectTopDocuments(ExecutionPolicy &&policy, std::vector<Document> &documents);
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+    std::vector<Document> FindTopDocumentsByRating(ExecutionPolicy &&policy, const Q &query, const DocumentPredicate &document_predicate) const;
+    // Слоты, заранее отобранные фильтром-выражением
+    struct SlotSelection
+    {
+        std::vector<uint64_t> words;
+    };
 
+    // Фильтр по статусу (DocumentPredicate = DocumentStatus) проверяется по битовой карте,
+    // выражение document_filter — по столбцам, произвольный предикат вызывается
+    // со значениями из столбцов
+    template <typename DocumentPredicate>
+    bool IsAccepted(const DocumentPredicate &document_predicate, DocumentColumns::Slot slot) const;
+    template <typename ExecutionPolicy, typename Expression>
+    SlotSelection SelectSlots(ExecutionPolicy &&policy, const Expression &expression) const;
+    // Возвращает false, если пришлось проверить больше max_visited документов
+    template <typename DocumentPredicate, typename Q>
+    bool FindDocumentsByRating(const Q &query, const DocumentPredicate &document_predicate, size_t max_visited, std::vector<Document> &matched_documents) const;
+    // То же слиянием ranked_postings; требует OrderByStaticRank
+    template <typename DocumentPredicate, typename Q>
+    void FindDocumentsByStaticRank(const Q &query, const DocumentPredicate &document_predicate, std::vector<Document> &matched_documents) const;
+    // С exact_relevance квантованные веса не используются
     template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy &&policy, const Q &query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindAllDocuments(ExecutionPolicy &&policy, const Q &query, DocumentPredicate document_predicate, bool exact_relevance = false) const;
+    template <typename Score, typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+    std::vector<Document> AccumulateRelevance(ExecutionPolicy &&policy, const Q &query, DocumentPredicate document_predicate, double scale) const;
 };
 
 template <typename StringContainer>
@@ -112,6 +487,272 @@ SearchServer::SearchServer(const StringContainer &stop_words)
     {
         throw std::invalid_argument("Some of stop words are invalid"s);
     }
+    stop_word_set_ = StopWordSet(stop_words_);
+}
+
+template <typename StringContainer>
+SearchServer::SearchServer(const StringContainer &stop_words, const TextAnalyzer &analyzer)
+    : SearchServer(stop_words)
+{
+    analyzer_ = analyzer;
+    std::set<std::string, std::less<>> normalized_stop_words;
+    std::vector<std::string_view> words;
+    for (const std::string &stop_word : stop_words_)
+    {
+        std::string normalized;
+        analyzer.Analyze(stop_word, normalized, words);
+        normalized_stop_words.insert(words.begin(), words.end());
+    }
+    stop_words_ = std::move(normalized_stop_words);
+    stop_word_set_ = StopWordSet(stop_words_);
+}
+
+template <typename AddWord>
+SearchServer::WordError SearchServer::ParseQueryWords(const std::string_view text, std::vector<char> &normalized_text, AddWord add_word) const
+{
+    static thread_local std::vector<std::string_view> words;
+    static thread_local std::vector<QueryWord> query_words;
+    const size_t invalid_index = SplitIntoWords(text, words);
+    if (invalid_index < words.size())
+    {
+        return {SearchError::INVALID_WORD, words[invalid_index]};
+    }
+    query_words.resize(words.size());
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        const SearchError error = ParseQueryWord(words[i], query_words[i]);
+        if (error != SearchError::NONE)
+        {
+            return {error, words[i]};
+        }
+    }
+    if (!analyzer_)
+    {
+        for (const QueryWord &query_word : query_words)
+        {
+            if (!query_word.is_stop)
+            {
+                add_word(query_word.data, query_word.is_minus);
+            }
+        }
+        return {};
+    }
+
+    // Нормализация никогда не удлиняет текст: после reserve буфер не перевыделяется
+    normalized_text.reserve(text.size());
+    static thread_local std::vector<std::string_view> normalized_words;
+    for (const QueryWord &query_word : query_words)
+    {
+        const size_t offset = normalized_text.size();
+        normalized_text.resize(offset + query_word.data.size());
+        size_t written = 0;
+        analyzer_->Analyze(query_word.data, normalized_text.data() + offset, written, normalized_words);
+        normalized_text.resize(offset + written);
+        for (const std::string_view normalized_word : normalized_words)
+        {
+            if (!IsStopWord(normalized_word))
+            {
+                add_word(normalized_word, query_word.is_minus);
+            }
+        }
+    }
+    return {};
+}
+
+template <typename Q>
+SearchServer::TermQuery SearchServer::ResolveTerms(const Q &query) const
+{
+    TermQuery result;
+    const auto resolve = [this](const auto &words, std::vector<TermId> &term_ids)
+    {
+        term_ids.reserve(words.size());
+        for (const std::string_view word : words)
+        {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it != word_to_document_freqs_.end())
+            {
+                term_ids.push_back(it->second.term_id);
+            }
+        }
+        std::sort(term_ids.begin(), term_ids.end());
+    };
+    resolve(query.plus_words, result.plus_terms);
+    resolve(query.minus_words, result.minus_terms);
+    return result;
+}
+
+template <typename OnMatch>
+void SearchServer::IntersectTerms(const std::vector<TermId> &lhs, const std::vector<TermId> &rhs, OnMatch on_match)
+{
+    // Оба списка отсортированы: пересечение за один проход без поиска по дереву
+    for (size_t l = 0, r = 0; l < lhs.size() && r < rhs.size();)
+    {
+        if (lhs[l] < rhs[r])
+        {
+            ++l;
+        }
+        else if (rhs[r] < lhs[l])
+        {
+            ++r;
+        }
+        else
+        {
+            if (!on_match(l, r))
+            {
+                return;
+            }
+            ++l;
+            ++r;
+        }
+    }
+}
+
+template <typename Words>
+size_t SearchServer::CountPostings(const Words &words) const
+{
+    size_t posting_count = 0;
+    for (const std::string_view word : words)
+    {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end())
+        {
+            posting_count += it->second.document_freqs.size();
+        }
+    }
+    return posting_count;
+}
+
+template <typename ExecutionPolicy, typename Q>
+std::vector<std::pair<int, uint32_t>> SearchServer::CollectMatches(ExecutionPolicy &&policy, const Q &query, std::vector<std::string_view> &words) const
+{
+    // plus_words отсортированы, поэтому номера слов идут в алфавитном порядке
+    std::vector<const std::map<int, Posting> *> postings;
+    words.clear();
+    for (const std::string_view word : query.plus_words)
+    {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end())
+        {
+            words.push_back(it->first);
+            postings.push_back(&it->second.document_freqs);
+        }
+    }
+    std::vector<size_t> offsets(postings.size() + 1, 0);
+    for (size_t i = 0; i < postings.size(); ++i)
+    {
+        offsets[i + 1] = offsets[i] + postings[i]->size();
+    }
+    std::vector<std::pair<int, uint32_t>> matches(offsets.back());
+    std::vector<uint32_t> word_indexes(postings.size());
+    std::iota(word_indexes.begin(), word_indexes.end(), 0);
+    std::for_each(policy,
+                  word_indexes.begin(), word_indexes.end(),
+                  [&matches, &offsets, &postings](uint32_t word_index)
+                  {
+                      auto out = matches.begin() + offsets[word_index];
+                      for (const auto &[document_id, posting] : *postings[word_index])
+                      {
+                          *out++ = {document_id, word_index};
+                      }
+                  });
+    std::sort(policy, matches.begin(), matches.end());
+
+    std::vector<int> excluded;
+    for (const std::string_view word : query.minus_words)
+    {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end())
+        {
+            for (const auto &[document_id, posting] : it->second.document_freqs)
+            {
+                excluded.push_back(document_id);
+            }
+        }
+    }
+    if (!excluded.empty())
+    {
+        std::sort(policy, excluded.begin(), excluded.end());
+        matches.erase(std::remove_if(policy, matches.begin(), matches.end(), [&excluded](const auto &match)
+                                     { return std::binary_search(excluded.begin(), excluded.end(), match.first); }),
+                      matches.end());
+    }
+    return matches;
+}
+
+template <typename DocumentPredicate>
+std::vector<MatchedDocument> SearchServer::MatchAllDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    return MatchAllDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<MatchedDocument> SearchServer::MatchAllDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    const auto query = ParseQuery(policy, raw_query);
+    std::vector<std::string_view> words;
+    const auto matches = CollectMatches(policy, query, words);
+
+    std::vector<size_t> group_begins;
+    for (size_t i = 0; i < matches.size(); ++i)
+    {
+        if (i == 0 || matches[i].first != matches[i - 1].first)
+        {
+            group_begins.push_back(i);
+        }
+    }
+    group_begins.push_back(matches.size());
+
+    // Документы, не прошедшие предикат, остаются строками без слов и отбрасываются
+    std::vector<MatchedDocument> result(group_begins.size() - 1);
+    std::for_each(policy,
+                  result.begin(), result.end(),
+                  [this, &document_predicate, &matches, &words, &group_begins, &result](MatchedDocument &row)
+                  {
+                      const size_t group = &row - result.data();
+                      const int document_id = matches[group_begins[group]].first;
+                      const DocumentColumns::Slot slot = documents_.at(document_id).slot;
+                      row.id = document_id;
+                      row.status = columns_.GetStatus(slot);
+                      if (!IsAccepted(document_predicate, slot))
+                      {
+                          return;
+                      }
+                      row.words.reserve(group_begins[group + 1] - group_begins[group]);
+                      for (size_t i = group_begins[group]; i < group_begins[group + 1]; ++i)
+                      {
+                          row.words.push_back(words[matches[i].second]);
+                      }
+                  });
+    result.erase(std::remove_if(result.begin(), result.end(), [](const MatchedDocument &row)
+                                { return row.words.empty(); }),
+                 result.end());
+    return result;
+}
+
+template <typename DocumentPredicate, typename Callback>
+void SearchServer::ForEachMatchedDocument(const std::string_view raw_query, DocumentPredicate document_predicate, Callback callback) const
+{
+    const auto query = ParseQuery(std::execution::seq, raw_query);
+    std::vector<std::string_view> words;
+    const auto matches = CollectMatches(std::execution::seq, query, words);
+
+    MatchedDocument row;
+    for (size_t begin = 0, end = 0; begin < matches.size(); begin = end)
+    {
+        row.id = matches[begin].first;
+        row.words.clear();
+        while (end < matches.size() && matches[end].first == row.id)
+        {
+            row.words.push_back(words[matches[end].second]);
+            ++end;
+        }
+        const DocumentColumns::Slot slot = documents_.at(row.id).slot;
+        row.status = columns_.GetStatus(slot);
+        if (IsAccepted(document_predicate, slot))
+        {
+            callback(static_cast<const MatchedDocument &>(row));
+        }
+    }
 }
 
 // Обертки по поиску
@@ -126,8 +767,7 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, c
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentStatus status) const
 {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-                            { return document_status == status; });
+    return FindTopDocumentsImpl(policy, raw_query, status);
 }
 
 template <typename DocumentPredicate>
@@ -141,75 +781,519 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
 {
-    const auto query = ParseQuery(policy, raw_query);
+    return FindTopDocumentsImpl(policy, raw_query, document_predicate);
+}
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate, const InverseDocumentFreqs &inverse_document_freqs) const
+{
+    return FindTopDocumentsImpl(policy, raw_query, document_predicate, &inverse_document_freqs);
+}
 
-    std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document &lhs, const Document &rhs)
-              {
-            //Постоянно меняется мой код. Всегда была константа.
-                if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) 
-                {
-                    return lhs.rating > rhs.rating;
-                }
-                else
-                {
-                    return lhs.relevance > rhs.relevance;
-                } });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+template <typename Q>
+size_t SearchServer::EstimateSearchWork(const Q &query) const
+{
+    return CountPostings(query.plus_words) + CountPostings(query.minus_words);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsImpl(ExecutionPolicy &&policy, const std::string_view raw_query, const DocumentPredicate &document_predicate, const InverseDocumentFreqs *inverse_document_freqs) const
+{
+    return ValueOrThrow(TryFindTopDocumentsImpl(policy, raw_query, document_predicate, inverse_document_freqs));
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchOutcome<std::vector<Document>> SearchServer::TryFindTopDocumentsImpl(ExecutionPolicy &&policy, const std::string_view raw_query, const DocumentPredicate &document_predicate, const InverseDocumentFreqs *inverse_document_freqs) const
+{
+    SearchOutcome<std::vector<Document>> outcome;
+    if constexpr (search_execution::IS_AUTOMATIC<ExecutionPolicy>)
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        // Запрос разбирается один раз: для оценки нужны его слова, а выполнять можно
+        // любой политикой
+        Query query;
+        const WordError parse_error = TryParseQuery(std::execution::seq, raw_query, query);
+        if (parse_error.error != SearchError::NONE)
+        {
+            outcome.error = parse_error.error;
+            outcome.word = parse_error.word;
+            return outcome;
+        }
+        query.inverse_document_freqs = inverse_document_freqs;
+        outcome.value = execution_planner_.Run(EstimateSearchWork(query), [this, &query, &document_predicate](const auto &chosen_policy)
+                                               { return FindTopDocumentsInQuery(chosen_policy, query, document_predicate); });
+    }
+    else
+    {
+        QueryFor<ExecutionPolicy> query;
+        const WordError parse_error = TryParseQuery(policy, raw_query, query);
+        if (parse_error.error != SearchError::NONE)
+        {
+            outcome.error = parse_error.error;
+            outcome.word = parse_error.word;
+            return outcome;
+        }
+        query.inverse_document_freqs = inverse_document_freqs;
+        outcome.value = FindTopDocumentsInQuery(policy, query, document_predicate);
     }
+    return outcome;
+}
+
+template <typename DocumentPredicate>
+SearchOutcome<std::vector<Document>> SearchServer::TryFindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    return TryFindTopDocumentsImpl(std::execution::seq, raw_query, document_predicate, nullptr);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchOutcome<std::vector<Document>> SearchServer::TryFindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    return TryFindTopDocumentsImpl(policy, raw_query, document_predicate, nullptr);
+}
+
+template <typename ExecutionPolicy>
+SearchOutcome<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::TryMatchDocument(ExecutionPolicy &&policy, const std::string_view raw_query, int document_id) const
+{
+    SearchOutcome<std::tuple<std::vector<std::string_view>, DocumentStatus>> outcome;
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end())
+    {
+        outcome.error = SearchError::UNKNOWN_DOCUMENT;
+        return outcome;
+    }
+    const DocumentData &document_data = it->second;
+    if constexpr (search_execution::IS_AUTOMATIC<ExecutionPolicy>)
+    {
+        // Параллельно выполняется только разбор запроса, слияние с документом последовательное
+        return execution_planner_.Run(raw_query.size() * PARSE_BYTE_WORK + document_data.term_ids.size(), [this, raw_query, document_id](const auto &chosen_policy)
+                                      { return TryMatchDocument(chosen_policy, raw_query, document_id); });
+    }
+    else
+    {
+        QueryFor<ExecutionPolicy> query;
+        const WordError parse_error = TryParseQuery(policy, raw_query, query);
+        if (parse_error.error != SearchError::NONE)
+        {
+            outcome.error = parse_error.error;
+            outcome.word = parse_error.word;
+            return outcome;
+        }
+        outcome.value = {MatchTerms(ResolveTerms(query), document_data), columns_.GetStatus(document_data.slot)};
+        return outcome;
+    }
+}
 
+template <typename T>
+T SearchServer::ValueOrThrow(SearchOutcome<T> &&outcome)
+{
+    if (outcome.error != SearchError::NONE)
+    {
+        ThrowSearchError(outcome.error, outcome.word);
+    }
+    return std::move(outcome.value);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+std::vector<Document> SearchServer::FindTopDocumentsInQuery(ExecutionPolicy &&policy, const Q &query, const DocumentPredicate &document_predicate) const
+{
+    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    SelectTopDocuments(policy, matched_documents);
     return matched_documents;
 }
 
+template <typename ExecutionPolicy>
+void SearchServer::SelectTopDocuments(ExecutionPolicy &&policy, std::vector<Document> &documents)
+{
+    std::sort(policy, documents.begin(), documents.end(), IsRankedBefore);
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+BudgetedSearchResult SearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate, const SearchBudget &budget) const
+{
+    if constexpr (search_execution::IS_AUTOMATIC<ExecutionPolicy>)
+    {
+        const auto query = ParseQuery(std::execution::seq, raw_query);
+        size_t work = EstimateSearchWork(query);
+        if (budget.max_postings != 0)
+        {
+            work = std::min(work, budget.max_postings + CountPostings(query.minus_words));
+        }
+        return execution_planner_.Run(work, [this, &query, &document_predicate, &budget](const auto &chosen_policy)
+                                      { return FindTopDocumentsWithin(chosen_policy, query, document_predicate, budget); });
+    }
+    else
+    {
+        return FindTopDocumentsWithin(policy, ParseQuery(policy, raw_query), document_predicate, budget);
+    }
+}
+
 template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy &&policy, const Q &query, DocumentPredicate document_predicate) const
+BudgetedSearchResult SearchServer::FindTopDocumentsWithin(ExecutionPolicy &&policy, const Q &query, const DocumentPredicate &document_predicate, const SearchBudget &budget) const
 {
-    ConcurrentMap<int, double> document_to_relevance(10);
+    BudgetedSearchResult result;
+    std::vector<const WordPostings *> plus_postings;
+    plus_postings.reserve(query.plus_words.size());
+    for (const std::string_view word : query.plus_words)
+    {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end())
+        {
+            plus_postings.push_back(&it->second);
+        }
+    }
+    std::sort(plus_postings.begin(), plus_postings.end(), [](const WordPostings *lhs, const WordPostings *rhs)
+              { return lhs->document_freqs.size() < rhs->document_freqs.size(); });
+
+    const size_t candidate_count = CountPostings(query.plus_words) + CountPostings(query.minus_words);
+    AtomicConcurrentMap<DocumentColumns::Slot, double> document_to_relevance(std::min(candidate_count, documents_.size()));
     std::for_each(policy,
-                  query.plus_words.begin(), query.plus_words.end(),
-                  [this, &document_to_relevance, &document_predicate, &policy](const std::string_view word)
+                  query.minus_words.begin(), query.minus_words.end(),
+                  [this, &document_to_relevance, &policy](const std::string_view word)
                   {
-                      if (word_to_document_freqs_.count(word) > 0)
+                      const auto it = word_to_document_freqs_.find(word);
+                      if (it != word_to_document_freqs_.end())
                       {
-                          const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
                           std::for_each(policy,
-                                        word_to_document_freqs_.at(word).begin(), word_to_document_freqs_.at(word).end(),
-                                        [this, &document_to_relevance, &document_predicate, &inverse_document_freq](const auto &p)
+                                        it->second.document_freqs.begin(), it->second.document_freqs.end(),
+                                        [&document_to_relevance](const auto &p)
                                         {
-                                            const auto &document_data = documents_.at(p.first);
-                                            if (document_predicate(p.first, document_data.status, document_data.rating))
-                                            {
-                                                document_to_relevance[p.first].ref_to_value += p.second * inverse_document_freq;
-                                            }
+                                            document_to_relevance.Exclude(p.second.slot);
                                         });
                       }
                   });
+    for (size_t i = 0; i < plus_postings.size(); ++i)
+    {
+        const WordPostings &postings = *plus_postings[i];
+        if ((budget.max_postings != 0 && result.postings_scored + postings.document_freqs.size() > budget.max_postings) ||
+            std::chrono::steady_clock::now() >= budget.deadline)
+        {
+            result.partial = true;
+            result.skipped_words = plus_postings.size() - i;
+            break;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(postings);
+        std::for_each(policy,
+                      postings.document_freqs.begin(), postings.document_freqs.end(),
+                      [this, &document_to_relevance, &document_predicate, inverse_document_freq](const auto &p)
+                      {
+                          if (IsAccepted(document_predicate, p.second.slot))
+                          {
+                              document_to_relevance.FetchAdd(p.second.slot, p.second.term_freq * inverse_document_freq);
+                          }
+                      });
+        result.postings_scored += postings.document_freqs.size();
+    }
+    document_to_relevance.ForEach([this, &result](DocumentColumns::Slot slot, double relevance)
+                                  { result.documents.emplace_back(columns_.GetId(slot), relevance, columns_.GetRating(slot)); });
+    SelectTopDocuments(policy, result.documents);
+    return result;
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate, ResultOrder order) const
+{
+    if (order == ResultOrder::RELEVANCE)
+    {
+        return FindTopDocumentsImpl(policy, raw_query, document_predicate);
+    }
+    if constexpr (search_execution::IS_AUTOMATIC<ExecutionPolicy>)
+    {
+        const auto query = ParseQuery(std::execution::seq, raw_query);
+        return execution_planner_.Run(EstimateSearchWork(query), [this, &query, &document_predicate](const auto &chosen_policy)
+                                      { return FindTopDocumentsByRating(chosen_policy, query, document_predicate); });
+    }
+    else
+    {
+        return FindTopDocumentsByRating(policy, ParseQuery(policy, raw_query), document_predicate);
+    }
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+std::vector<Document> SearchServer::FindTopDocumentsByRating(ExecutionPolicy &&policy, const Q &query, const DocumentPredicate &document_predicate) const
+{
+    std::vector<Document> matched_documents;
+    if (ordered_by_static_rank_)
+    {
+        FindDocumentsByStaticRank(query, document_predicate, matched_documents);
+    }
+    // Проверка документа при переборе обходится примерно как оценка восьми записей posting-листов
+    else if (!FindDocumentsByRating(query, document_predicate, CountPostings(query.plus_words) / 8, matched_documents))
+    {
+        matched_documents = FindAllDocuments(policy, query, document_predicate, true);
+    }
+    std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document &lhs, const Document &rhs)
+              {
+                  if (lhs.rating != rhs.rating)
+                  {
+                      return lhs.rating > rhs.rating;
+                  }
+                  if (lhs.relevance != rhs.relevance)
+                  {
+                      return lhs.relevance > rhs.relevance;
+                  }
+                  return lhs.id < rhs.id; });
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return matched_documents;
+}
+
+template <typename DocumentPredicate, typename Q>
+bool SearchServer::FindDocumentsByRating(const Q &query, const DocumentPredicate &document_predicate, size_t max_visited, std::vector<Document> &matched_documents) const
+{
+    const TermQuery terms = ResolveTerms(query);
+    std::vector<double> inverse_document_freqs;
+    inverse_document_freqs.reserve(terms.plus_terms.size());
+    for (const TermId term_id : terms.plus_terms)
+    {
+        inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(terms_[term_id]->second));
+    }
+
+    // Документы приходят по убыванию рейтинга: после MAX_RESULT_DOCUMENT_COUNT найденных
+    // дочитывается только текущий рейтинг, чтобы порядок внутри него решила релевантность
+    size_t visited = 0;
+    bool completed = true;
+    columns_.GetRatingIndex().ForEachDescending([&](DocumentColumns::Slot slot, int rating)
+                                                {
+        if (matched_documents.size() >= MAX_RESULT_DOCUMENT_COUNT && matched_documents.back().rating != rating)
+        {
+            return false;
+        }
+        if (++visited > max_visited)
+        {
+            completed = false;
+            return false;
+        }
+        if (!IsAccepted(document_predicate, slot))
+        {
+            return true;
+        }
+        const int document_id = columns_.GetId(slot);
+        const DocumentData &document_data = documents_.at(document_id);
+        if (HasCommonTerm(terms.minus_terms, document_data.term_ids))
+        {
+            return true;
+        }
+        double relevance = 0.0;
+        bool has_plus_word = false;
+        IntersectTerms(terms.plus_terms, document_data.term_ids, [&](size_t query_index, size_t document_index)
+                       {
+                           relevance += document_data.term_freqs[document_index] * inverse_document_freqs[query_index];
+                           has_plus_word = true;
+                           return true; });
+        if (has_plus_word)
+        {
+            matched_documents.emplace_back(document_id, relevance, rating);
+        }
+        return true; });
+    return completed;
+}
+
+template <typename DocumentPredicate, typename Q>
+void SearchServer::FindDocumentsByStaticRank(const Q &query, const DocumentPredicate &document_predicate, std::vector<Document> &matched_documents) const
+{
+    const TermQuery terms = ResolveTerms(query);
+    std::vector<const std::vector<Posting> *> postings;
+    std::vector<double> inverse_document_freqs;
+    postings.reserve(terms.plus_terms.size());
+    inverse_document_freqs.reserve(terms.plus_terms.size());
+    for (const TermId term_id : terms.plus_terms)
+    {
+        const WordPostings &word_postings = terms_[term_id]->second;
+        postings.push_back(&word_postings.ranked_postings);
+        inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(word_postings));
+    }
+
+    // Слоты идут по убыванию рейтинга: когда набрано MAX_RESULT_DOCUMENT_COUNT документов
+    // и рейтинг сменился, оставшиеся записи уже не попадут в выдачу
+    std::vector<size_t> positions(postings.size(), 0);
+    constexpr DocumentColumns::Slot no_slot = std::numeric_limits<DocumentColumns::Slot>::max();
+    while (true)
+    {
+        DocumentColumns::Slot slot = no_slot;
+        for (size_t i = 0; i < postings.size(); ++i)
+        {
+            if (positions[i] < postings[i]->size())
+            {
+                slot = std::min(slot, (*postings[i])[positions[i]].slot);
+            }
+        }
+        if (slot == no_slot)
+        {
+            return;
+        }
+        const int rating = columns_.GetRating(slot);
+        if (matched_documents.size() >= MAX_RESULT_DOCUMENT_COUNT && matched_documents.back().rating != rating)
+        {
+            return;
+        }
+        double relevance = 0.0;
+        for (size_t i = 0; i < postings.size(); ++i)
+        {
+            if (positions[i] < postings[i]->size() && (*postings[i])[positions[i]].slot == slot)
+            {
+                relevance += (*postings[i])[positions[i]].term_freq * inverse_document_freqs[i];
+                ++positions[i];
+            }
+        }
+        if (!IsAccepted(document_predicate, slot))
+        {
+            continue;
+        }
+        const int document_id = columns_.GetId(slot);
+        if (!terms.minus_terms.empty() && HasCommonTerm(terms.minus_terms, documents_.at(document_id).term_ids))
+        {
+            continue;
+        }
+        matched_documents.emplace_back(document_id, relevance, rating);
+    }
+}
+
+template <typename DocumentPredicate>
+bool SearchServer::IsAccepted(const DocumentPredicate &document_predicate, DocumentColumns::Slot slot) const
+{
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>)
+    {
+        return columns_.HasStatus(slot, document_predicate);
+    }
+    else if constexpr (std::is_same_v<DocumentPredicate, SlotSelection>)
+    {
+        return document_predicate.words[slot >> 6] >> (slot & 63) & 1;
+    }
+    else if constexpr (document_filter::IS_EXPRESSION<DocumentPredicate>)
+    {
+        return document_predicate.Matches(columns_, slot);
+    }
+    else
+    {
+        return document_predicate(columns_.GetId(slot), columns_.GetStatus(slot), columns_.GetRating(slot));
+    }
+}
+
+template <typename ExecutionPolicy, typename Expression>
+SearchServer::SlotSelection SearchServer::SelectSlots(ExecutionPolicy &&policy, const Expression &expression) const
+{
+    SlotSelection selection;
+    selection.words.resize((columns_.GetSlotCount() + 63) / 64);
+    std::for_each(policy,
+                  selection.words.begin(), selection.words.end(),
+                  [this, &expression, &selection](uint64_t &word)
+                  {
+                      word = expression.SelectWord(columns_, &word - selection.words.data());
+                  });
+    return selection;
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy &&policy, const Q &query, DocumentPredicate document_predicate, bool exact_relevance) const
+{
+    if constexpr (document_filter::IS_EXPRESSION<DocumentPredicate> && !std::is_same_v<DocumentPredicate, document_filter::StatusIs>)
+    {
+        // Если записей в posting-листах не меньше четверти числа документов, выражение дешевле
+        // один раз свернуть в битовую карту: 64 документа за операцию вместо проверки каждой записи
+        if (CountPostings(query.plus_words) * 4 >= columns_.GetSlotCount())
+        {
+            return FindAllDocuments(policy, query, SelectSlots(policy, document_predicate), exact_relevance);
+        }
+    }
+    // Веса посчитаны с IDF этого сервера, внешние IDF применяются только к TF
+    exact_relevance = exact_relevance || query.inverse_document_freqs != nullptr;
+    if (!exact_relevance && (impact_precision_ == ImpactPrecision::UINT16 || impact_precision_ == ImpactPrecision::UINT8))
+    {
+        // Квантованные веса суммируются в целых числах и переводятся в релевантность в конце
+        return AccumulateRelevance<uint32_t>(policy, query, document_predicate, impact_quantum_);
+    }
+    return AccumulateRelevance<double>(policy, query, document_predicate, 1.0);
+}
+
+template <typename Score, typename ExecutionPolicy, typename DocumentPredicate, typename Q>
+std::vector<Document> SearchServer::AccumulateRelevance(ExecutionPolicy &&policy, const Q &query, DocumentPredicate document_predicate, double scale) const
+{
+    // Верхняя оценка числа документов-кандидатов задаёт ёмкость неблокирующего словаря
+    const size_t candidate_count = CountPostings(query.plus_words) + CountPostings(query.minus_words);
+    // Релевантность накапливается по слотам документов
+    AtomicConcurrentMap<DocumentColumns::Slot, Score> document_to_relevance(std::min(candidate_count, documents_.size()));
     std::for_each(policy,
                   query.minus_words.begin(), query.minus_words.end(),
                   [this, &document_to_relevance, &policy](const std::string_view word)
                   {
-                      if (word_to_document_freqs_.count(word) > 0)
+                      const auto it = word_to_document_freqs_.find(word);
+                      if (it != word_to_document_freqs_.end())
                       {
                           std::for_each(policy,
-                                        word_to_document_freqs_.at(word).begin(), word_to_document_freqs_.at(word).end(),
+                                        it->second.document_freqs.begin(), it->second.document_freqs.end(),
                                         [&document_to_relevance](const auto &p)
                                         {
-                                            document_to_relevance.erase(p.first);
+                                            document_to_relevance.Exclude(p.second.slot);
                                         });
                       }
                   });
-    auto result = document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents(result.size());
-    std::atomic_int index = 0;
+    // Готовые веса лежат в отдельных массивах: слот документа и вес с тем же индексом
+    const auto accumulate_impacts = [this, &document_to_relevance, &document_predicate, &policy](const std::vector<DocumentColumns::Slot> &slots, const auto &impacts)
+    {
+        std::for_each(policy,
+                      slots.begin(), slots.end(),
+                      [this, &document_to_relevance, &document_predicate, &slots, &impacts](const DocumentColumns::Slot &slot)
+                      {
+                          if (IsAccepted(document_predicate, slot))
+                          {
+                              document_to_relevance.FetchAdd(slot, impacts[&slot - slots.data()]);
+                          }
+                      });
+    };
     std::for_each(policy,
-                  result.begin(), result.end(),
-                  [this, &matched_documents, &index](const auto &p)
+                  query.plus_words.begin(), query.plus_words.end(),
+                  [this, &query, &document_to_relevance, &document_predicate, &policy, &accumulate_impacts](const std::string_view word)
                   {
-                      matched_documents[index++] = Document(p.first, p.second, documents_.at(p.first).rating);
+                      const auto it = word_to_document_freqs_.find(word);
+                      if (it == word_to_document_freqs_.end())
+                      {
+                          return;
+                      }
+                      const WordPostings &postings = it->second;
+                      if constexpr (std::is_floating_point_v<Score>)
+                      {
+                          if (impact_precision_ == ImpactPrecision::DOUBLE && query.inverse_document_freqs == nullptr)
+                          {
+                              accumulate_impacts(postings.impact_slots, postings.impacts);
+                              return;
+                          }
+                          double inverse_document_freq = ComputeWordInverseDocumentFreq(postings);
+                          if (query.inverse_document_freqs != nullptr)
+                          {
+                              const auto external = query.inverse_document_freqs->find(word);
+                              if (external == query.inverse_document_freqs->end())
+                              {
+                                  return;
+                              }
+                              inverse_document_freq = external->second;
+                          }
+                          std::for_each(policy,
+                                        postings.document_freqs.begin(), postings.document_freqs.end(),
+                                        [this, &document_to_relevance, &document_predicate, inverse_document_freq](const auto &p)
+                                        {
+                                            if (IsAccepted(document_predicate, p.second.slot))
+                                            {
+                                                document_to_relevance.FetchAdd(p.second.slot, p.second.term_freq * inverse_document_freq);
+                                            }
+                                        });
+                      }
+                      else if (impact_precision_ == ImpactPrecision::UINT16)
+                      {
+                          accumulate_impacts(postings.impact_slots, postings.impacts16);
+                      }
+                      else
+                      {
+                          accumulate_impacts(postings.impact_slots, postings.impacts8);
+                      }
                   });
+    std::vector<Document> matched_documents;
+    document_to_relevance.ForEach([this, &matched_documents, scale](DocumentColumns::Slot slot, Score score)
+                                  { matched_documents.emplace_back(columns_.GetId(slot), score * scale, columns_.GetRating(slot)); });
     return matched_documents;
 }
 
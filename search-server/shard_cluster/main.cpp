@@ -0,0 +1,311 @@
+// Шарды в отдельных процессах и ShardCoordinator на одной машине.
+//
+// Без --serve запускает --shards процессов-шардов (этот же исполняемый файл с --serve),
+// загружает документы через координатор и в контрольный SearchServer, сверяет выдачу
+// и замеряет латентность. Затем проверяет отказы: зависший шард (SIGSTOP) и убитый шард
+// (SIGKILL) дают неполную выдачу за время не больше timeout, перезапущенный шард снова
+// отвечает. Отчёт — BenchmarkReport (TSV); код возврата 1, если проверка не прошла.
+//
+// Сборка (из каталога search-server/shard_cluster):
+//   g++ --std=c++17 -O2 -pthread main.cpp $(ls ../*.cpp | grep -v main.cpp) -o build/main -ltbb
+//
+// Пример:
+//   ./build/main --shards=4 --documents=20000 --timeout-ms=200
+//   ./build/main --serve=/tmp/shard0.sock --stop-words="and in on"
+
+#include "../search_server.h"
+#include "../shard_coordinator.h"
+#include "../shard_service.h"
+#include "../test_example_functions.h"
+#include "../benchmark_stats.h"
+#include <csignal>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct ClusterOptions
+{
+    int shards = 4;
+    int documents = 10'000;
+    int dictionary = 1'000;
+    int document_words = 70;
+    int queries = 500;
+    int query_words = 10;
+    double minus_prob = 0.1;
+    int timeout_ms = 200;
+    unsigned seed = mt19937::default_seed;
+    string socket_dir = "/tmp"s;
+    // Путь сокета: процесс работает одним шардом
+    string serve;
+    string stop_words;
+    string baseline;
+};
+
+ClusterOptions ParseOptions(int argc, char **argv)
+{
+    ClusterOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string_view arg = argv[i];
+        const auto eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos)
+        {
+            throw invalid_argument("Expected --name=value, got "s + string(arg));
+        }
+        const string_view name = arg.substr(2, eq - 2);
+        const string value(arg.substr(eq + 1));
+        if (name == "shards"sv)
+        {
+            options.shards = stoi(value);
+        }
+        else if (name == "documents"sv)
+        {
+            options.documents = stoi(value);
+        }
+        else if (name == "dictionary"sv)
+        {
+            options.dictionary = stoi(value);
+        }
+        else if (name == "document-words"sv)
+        {
+            options.document_words = stoi(value);
+        }
+        else if (name == "queries"sv)
+        {
+            options.queries = stoi(value);
+        }
+        else if (name == "query-words"sv)
+        {
+            options.query_words = stoi(value);
+        }
+        else if (name == "minus-prob"sv)
+        {
+            options.minus_prob = stod(value);
+        }
+        else if (name == "timeout-ms"sv)
+        {
+            options.timeout_ms = stoi(value);
+        }
+        else if (name == "seed"sv)
+        {
+            options.seed = static_cast<unsigned>(stoul(value));
+        }
+        else if (name == "socket-dir"sv)
+        {
+            options.socket_dir = value;
+        }
+        else if (name == "serve"sv)
+        {
+            options.serve = value;
+        }
+        else if (name == "stop-words"sv)
+        {
+            options.stop_words = value;
+        }
+        else if (name == "baseline"sv)
+        {
+            options.baseline = value;
+        }
+        else
+        {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    if (options.shards <= 0)
+    {
+        throw invalid_argument("Shard count must be positive"s);
+    }
+    return options;
+}
+
+// Запускает процесс-шард и ждёт, пока он начнёт принимать соединения
+pid_t StartShard(const string &socket_path, const string &stop_words)
+{
+    // Сокет убитого шарда остаётся в файловой системе и не должен считаться признаком готовности
+    unlink(socket_path.c_str());
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        const string serve_arg = "--serve="s + socket_path;
+        const string stop_words_arg = "--stop-words="s + stop_words;
+        execl("/proc/self/exe", "shard", serve_arg.c_str(), stop_words_arg.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    for (int attempt = 0; attempt < 500 && access(socket_path.c_str(), F_OK) != 0; ++attempt)
+    {
+        this_thread::sleep_for(10ms);
+    }
+    return pid;
+}
+
+bool SameDocuments(const vector<Document> &lhs, const vector<Document> &rhs)
+{
+    if (lhs.size() != rhs.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i)
+    {
+        if (lhs[i].id != rhs[i].id || abs(lhs[i].relevance - rhs[i].relevance) > EPSILON || lhs[i].rating != rhs[i].rating)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    ClusterOptions options;
+    try
+    {
+        options = ParseOptions(argc, argv);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (!options.serve.empty())
+    {
+        SearchServer search_server(options.stop_words);
+        ServeShard(search_server, options.serve);
+        return 0;
+    }
+
+    BenchmarkReport report;
+    report.AddParameter("shards"sv, to_string(options.shards));
+    report.AddParameter("documents"sv, to_string(options.documents));
+    report.AddParameter("dictionary"sv, to_string(options.dictionary));
+    report.AddParameter("document_words"sv, to_string(options.document_words));
+    report.AddParameter("queries"sv, to_string(options.queries));
+    report.AddParameter("query_words"sv, to_string(options.query_words));
+    report.AddParameter("timeout_ms"sv, to_string(options.timeout_ms));
+    report.AddParameter("seed"sv, to_string(options.seed));
+    if (!options.baseline.empty() && !report.LoadBaseline(options.baseline))
+    {
+        cerr << "Cannot read baseline "s << options.baseline << endl;
+        return 1;
+    }
+
+    mt19937 generator(options.seed);
+    const auto dictionary = GenerateDictionary(generator, options.dictionary, 10);
+    const auto documents = GenerateQueries(generator, dictionary, options.documents, options.document_words);
+    const auto queries = GenerateQueries(generator, dictionary, options.queries, options.query_words, options.minus_prob);
+    const string stop_words = dictionary.front();
+
+    vector<string> socket_paths;
+    vector<pid_t> pids;
+    for (int i = 0; i < options.shards; ++i)
+    {
+        socket_paths.push_back(options.socket_dir + "/search-shard-"s + to_string(getpid()) + "-"s + to_string(i) + ".sock"s);
+        pids.push_back(StartShard(socket_paths.back(), stop_words));
+    }
+
+    bool ok = true;
+    const auto check = [&ok](bool condition, string_view what)
+    {
+        if (!condition)
+        {
+            cerr << "FAILED: "s << what << endl;
+            ok = false;
+        }
+    };
+
+    try
+    {
+        ShardCoordinator coordinator(socket_paths, chrono::milliseconds(options.timeout_ms));
+        SearchServer reference(stop_words);
+
+        const double add_us = MeasureMicroseconds([&]
+                                                  {
+                                                      for (size_t i = 0; i < documents.size(); ++i)
+                                                      {
+                                                          coordinator.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+                                                      } });
+        for (size_t i = 0; i < documents.size(); ++i)
+        {
+            reference.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+        }
+        report.Add("add.throughput"sv, documents.size() / (add_us / 1e6), "docs/s");
+        check(coordinator.GetDocumentCount() == reference.GetDocumentCount(), "document count"sv);
+
+        vector<double> samples;
+        size_t mismatches = 0;
+        for (const string &query : queries)
+        {
+            ShardedSearchResult result;
+            samples.push_back(MeasureMicroseconds([&]
+                                                  { result = coordinator.FindTopDocuments(query); }));
+            mismatches += result.IsPartial() || !SameDocuments(result.documents, reference.FindTopDocuments(query));
+        }
+        report.AddLatency("find_top"sv, Summarize(move(samples)));
+        report.Add("find_top.mismatches"sv, mismatches, "queries");
+        check(mismatches == 0, "results match a single SearchServer"sv);
+
+        samples.clear();
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            const int document_id = static_cast<int>(i * 7919 % documents.size());
+            tuple<vector<string>, DocumentStatus> matched;
+            samples.push_back(MeasureMicroseconds([&]
+                                                  { matched = coordinator.MatchDocument(queries[i], document_id); }));
+            const auto [words, status] = reference.MatchDocument(queries[i], document_id);
+            check(get<0>(matched) == vector<string>(words.begin(), words.end()), "match document"sv);
+        }
+        report.AddLatency("match"sv, Summarize(move(samples)));
+
+        bool thrown = false;
+        try
+        {
+            coordinator.FindTopDocuments("cat --dog"sv);
+        }
+        catch (const invalid_argument &)
+        {
+            thrown = true;
+        }
+        check(thrown, "invalid query is rejected"sv);
+
+        // Зависший шард: выдача без него не позже timeout, после пробуждения он снова отвечает
+        kill(pids[0], SIGSTOP);
+        ShardedSearchResult stalled;
+        const double stalled_us = MeasureMicroseconds([&]
+                                                      { stalled = coordinator.FindTopDocuments(queries[0]); });
+        report.Add("fault.stalled_shard.latency"sv, stalled_us, "us");
+        check(stalled.IsPartial() && stalled.responded_shards + 1 == stalled.shard_count, "stalled shard is skipped"sv);
+        check(stalled_us < 2.0 * options.timeout_ms * 1000, "stalled shard respects the timeout"sv);
+        kill(pids[0], SIGCONT);
+        check(!coordinator.FindTopDocuments(queries[0]).IsPartial(), "resumed shard answers again"sv);
+
+        // Убитый шард: выдача без него; перезапущенный (пустой) шард снова отвечает
+        kill(pids[0], SIGKILL);
+        waitpid(pids[0], nullptr, 0);
+        check(coordinator.FindTopDocuments(queries[0]).IsPartial(), "killed shard is skipped"sv);
+        pids[0] = StartShard(socket_paths[0], stop_words);
+        check(!coordinator.FindTopDocuments(queries[0]).IsPartial(), "restarted shard answers again"sv);
+
+        coordinator.Shutdown();
+    }
+    catch (const exception &e)
+    {
+        check(false, e.what());
+        for (const pid_t pid : pids)
+        {
+            kill(pid, SIGKILL);
+        }
+    }
+    for (const pid_t pid : pids)
+    {
+        waitpid(pid, nullptr, 0);
+    }
+
+    report.Print(cout);
+    return ok ? 0 : 1;
+}
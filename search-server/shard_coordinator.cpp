@@ -0,0 +1,284 @@
+#include "shard_coordinator.h"
+#include "shard_protocol.h"
+#include "concurrent_map.h"
+#include "search_server.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace shard_protocol;
+
+namespace
+{
+    // Проверяет код ответа и отрезает его; ошибки шарда бросаются исключениями того же типа
+    std::vector<char> UnwrapResponse(std::vector<char> response)
+    {
+        using std::string_literals::operator""s;
+
+        MessageReader reader(response);
+        const auto code = static_cast<ResponseCode>(reader.GetU8());
+        if (code == ResponseCode::OK)
+        {
+            response.erase(response.begin());
+            return response;
+        }
+        const std::string message = reader.GetString();
+        switch (code)
+        {
+        case ResponseCode::INVALID_ARGUMENT:
+            throw std::invalid_argument(message);
+        case ResponseCode::OUT_OF_RANGE:
+            throw std::out_of_range(message);
+        default:
+            throw std::runtime_error("Shard error: "s + message);
+        }
+    }
+}
+
+ShardCoordinator::ShardCoordinator(std::vector<std::string> socket_paths, std::chrono::milliseconds timeout)
+    : timeout_(timeout)
+{
+    using std::string_literals::operator""s;
+
+    if (socket_paths.empty())
+    {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+    for (std::string &socket_path : socket_paths)
+    {
+        shards_.push_back({std::move(socket_path), -1});
+    }
+}
+
+ShardCoordinator::~ShardCoordinator()
+{
+    for (Connection &connection : shards_)
+    {
+        Disconnect(connection);
+    }
+}
+
+void ShardCoordinator::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::ADD_DOCUMENT));
+    request.PutI32(document_id);
+    request.PutString(document);
+    request.PutU8(static_cast<uint8_t>(status));
+    request.PutU32(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings)
+    {
+        request.PutI32(rating);
+    }
+    Call(GetShardOf(document_id), request.GetData());
+}
+
+void ShardCoordinator::RemoveDocument(int document_id)
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::REMOVE_DOCUMENT));
+    request.PutI32(document_id);
+    Call(GetShardOf(document_id), request.GetData());
+}
+
+ShardedSearchResult ShardCoordinator::FindTopDocuments(std::string_view raw_query, DocumentStatus status)
+{
+    ShardedSearchResult result;
+    result.shard_count = shards_.size();
+
+    // Шаг 1: числа документов со словами запроса
+    MessageWriter freqs_request;
+    freqs_request.PutU8(static_cast<uint8_t>(RequestType::DOCUMENT_FREQS));
+    freqs_request.PutString(raw_query);
+    std::vector<bool> targets(shards_.size(), true);
+    const auto freqs_responses = Broadcast(freqs_request.GetData(), targets);
+    uint64_t document_count = 0;
+    std::map<std::string, uint64_t> document_freqs;
+    for (size_t shard = 0; shard < shards_.size(); ++shard)
+    {
+        targets[shard] = freqs_responses[shard].has_value();
+        if (!targets[shard])
+        {
+            continue;
+        }
+        MessageReader reader(*freqs_responses[shard]);
+        document_count += reader.GetU32();
+        for (uint32_t count = reader.GetU32(); count > 0; --count)
+        {
+            std::string word = reader.GetString();
+            document_freqs[std::move(word)] += reader.GetU32();
+        }
+    }
+
+    // Шаг 2: поиск с IDF по ответившим шардам
+    MessageWriter find_request;
+    find_request.PutU8(static_cast<uint8_t>(RequestType::FIND_TOP));
+    find_request.PutString(raw_query);
+    find_request.PutU8(static_cast<uint8_t>(status));
+    const size_t word_count = std::count_if(document_freqs.begin(), document_freqs.end(), [](const auto &word_freq)
+                                            { return word_freq.second > 0; });
+    find_request.PutU32(static_cast<uint32_t>(word_count));
+    for (const auto &[word, document_freq] : document_freqs)
+    {
+        if (document_freq > 0)
+        {
+            find_request.PutString(word);
+            find_request.PutDouble(std::log(static_cast<double>(document_count) / document_freq));
+        }
+    }
+    const auto find_responses = Broadcast(find_request.GetData(), targets);
+    for (const auto &response : find_responses)
+    {
+        if (!response)
+        {
+            continue;
+        }
+        ++result.responded_shards;
+        MessageReader reader(*response);
+        for (uint32_t count = reader.GetU32(); count > 0; --count)
+        {
+            const int document_id = reader.GetI32();
+            const double relevance = reader.GetDouble();
+            result.documents.emplace_back(document_id, relevance, reader.GetI32());
+        }
+    }
+
+    std::sort(result.documents.begin(), result.documents.end(), IsRankedBefore);
+    if (result.documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    {
+        result.documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return result;
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardCoordinator::MatchDocument(std::string_view raw_query, int document_id)
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::MATCH_DOCUMENT));
+    request.PutString(raw_query);
+    request.PutI32(document_id);
+    const std::vector<char> response = Call(GetShardOf(document_id), request.GetData());
+    MessageReader reader(response);
+    const auto status = static_cast<DocumentStatus>(reader.GetU8());
+    std::vector<std::string> words(reader.GetU32());
+    for (std::string &word : words)
+    {
+        word = reader.GetString();
+    }
+    return {words, status};
+}
+
+int ShardCoordinator::GetDocumentCount()
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::DOCUMENT_COUNT));
+    int document_count = 0;
+    for (size_t shard = 0; shard < shards_.size(); ++shard)
+    {
+        const std::vector<char> response = Call(shard, request.GetData());
+        document_count += static_cast<int>(MessageReader(response).GetU32());
+    }
+    return document_count;
+}
+
+void ShardCoordinator::Shutdown()
+{
+    MessageWriter request;
+    request.PutU8(static_cast<uint8_t>(RequestType::SHUTDOWN));
+    Broadcast(request.GetData(), std::vector<bool>(shards_.size(), true));
+    for (Connection &connection : shards_)
+    {
+        Disconnect(connection);
+    }
+}
+
+size_t ShardCoordinator::GetShardCount() const
+{
+    return shards_.size();
+}
+
+size_t ShardCoordinator::GetShardOf(int document_id) const
+{
+    return MixKey(static_cast<uint64_t>(document_id)) % shards_.size();
+}
+
+bool ShardCoordinator::EnsureConnected(Connection &connection)
+{
+    if (connection.fd < 0)
+    {
+        connection.fd = ConnectUnixSocket(connection.socket_path, timeout_);
+    }
+    return connection.fd >= 0;
+}
+
+void ShardCoordinator::Disconnect(Connection &connection)
+{
+    if (connection.fd >= 0)
+    {
+        close(connection.fd);
+        connection.fd = -1;
+    }
+}
+
+std::vector<std::optional<std::vector<char>>> ShardCoordinator::Broadcast(const std::vector<char> &request, const std::vector<bool> &targets)
+{
+    // Запросы уходят всем шардам сразу, поэтому общий срок — один timeout, а не по timeout на шард
+    const Clock::time_point deadline = Clock::now() + timeout_;
+    std::vector<bool> sent(shards_.size(), false);
+    for (size_t shard = 0; shard < shards_.size(); ++shard)
+    {
+        if (!targets[shard] || !EnsureConnected(shards_[shard]))
+        {
+            continue;
+        }
+        sent[shard] = SendFrame(shards_[shard].fd, request);
+        if (!sent[shard])
+        {
+            Disconnect(shards_[shard]);
+        }
+    }
+
+    std::vector<std::optional<std::vector<char>>> responses(shards_.size());
+    for (size_t shard = 0; shard < shards_.size(); ++shard)
+    {
+        std::vector<char> response;
+        if (!sent[shard])
+        {
+            continue;
+        }
+        if (ReceiveFrame(shards_[shard].fd, response, deadline) && !response.empty())
+        {
+            responses[shard] = std::move(response);
+        }
+        else
+        {
+            // Опоздавший ответ сбил бы следующий запрос: соединение открывается заново
+            Disconnect(shards_[shard]);
+        }
+    }
+    // Ошибки бросаются только после чтения всех ответов, чтобы соединения остались согласованными
+    for (auto &response : responses)
+    {
+        if (response)
+        {
+            response = UnwrapResponse(std::move(*response));
+        }
+    }
+    return responses;
+}
+
+std::vector<char> ShardCoordinator::Call(size_t shard, const std::vector<char> &request)
+{
+    using std::string_literals::operator""s;
+
+    std::vector<bool> targets(shards_.size(), false);
+    targets[shard] = true;
+    auto responses = Broadcast(request, targets);
+    if (!responses[shard])
+    {
+        throw std::runtime_error("Shard "s + shards_[shard].socket_path + " is unavailable"s);
+    }
+    return std::move(*responses[shard]);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "document.h"
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Выдача по шардам: если часть шардов не ответила вовремя, выдача собрана без них
+struct ShardedSearchResult
+{
+    std::vector<Document> documents;
+    // Шарды, ответившие на оба шага поиска
+    size_t responded_shards = 0;
+    size_t shard_count = 0;
+
+    bool IsPartial() const
+    {
+        return responded_shards < shard_count;
+    }
+};
+
+/**
+ * Координатор шардов, работающих в отдельных процессах (ServeShard) на одной машине.
+ * Документы распределяются по шардам по хэшу id, как в ShardedSearchServer. Поиск идёт
+ * в два шага: числа документов со словами запроса со всех шардов, затем поиск с общими IDF.
+ * Каждый шаг ограничен timeout: шарды, не ответившие вовремя, пропускаются, и выдача
+ * помечается неполной. Соединение с таким шардом закрывается и восстанавливается при
+ * следующем запросе, так что перезапущенный шард подхватывается без перезапуска координатора.
+ *
+ * Ошибки шарда в запросе (некорректный запрос или документ) бросаются как invalid_argument
+ * или out_of_range; недоступность шарда при добавлении, удалении и сопоставлении — runtime_error.
+ */
+class ShardCoordinator
+{
+public:
+    ShardCoordinator(std::vector<std::string> socket_paths, std::chrono::milliseconds timeout);
+    ~ShardCoordinator();
+    ShardCoordinator(const ShardCoordinator &) = delete;
+    ShardCoordinator &operator=(const ShardCoordinator &) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+    void RemoveDocument(int document_id);
+    ShardedSearchResult FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id);
+    // Бросает runtime_error, если какой-то шард недоступен
+    int GetDocumentCount();
+    // Останавливает все доступные шарды
+    void Shutdown();
+
+    size_t GetShardCount() const;
+    size_t GetShardOf(int document_id) const;
+
+private:
+    struct Connection
+    {
+        std::string socket_path;
+        int fd = -1;
+    };
+
+    std::vector<Connection> shards_;
+    std::chrono::milliseconds timeout_;
+
+    bool EnsureConnected(Connection &connection);
+    void Disconnect(Connection &connection);
+    // Отправляет request шардам, отмеченным в targets, и ждёт ответы до общего срока.
+    // Ответы с кодом OK возвращаются без кода; ошибка шарда бросается; nullopt — шард не ответил
+    std::vector<std::optional<std::vector<char>>> Broadcast(const std::vector<char> &request, const std::vector<bool> &targets);
+    std::vector<char> Call(size_t shard, const std::vector<char> &request);
+};
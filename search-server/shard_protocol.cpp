@@ -0,0 +1,255 @@
+#include "shard_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace shard_protocol
+{
+    namespace
+    {
+        sockaddr_un MakeAddress(const std::string &socket_path)
+        {
+            using std::string_literals::operator""s;
+
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path))
+            {
+                throw std::invalid_argument("Socket path "s + socket_path + " is empty or too long"s);
+            }
+            std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+            return address;
+        }
+
+        // Время до deadline для poll: -1 — без ограничения
+        int RemainingMilliseconds(Clock::time_point deadline)
+        {
+            if (deadline == Clock::time_point::max())
+            {
+                return -1;
+            }
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            return remaining > 0 ? static_cast<int>(remaining) : 0;
+        }
+
+        bool ReadExact(int fd, char *data, size_t size, Clock::time_point deadline)
+        {
+            while (size > 0)
+            {
+                pollfd descriptor{fd, POLLIN, 0};
+                const int ready = poll(&descriptor, 1, RemainingMilliseconds(deadline));
+                if (ready < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (ready <= 0)
+                {
+                    return false;
+                }
+                const ssize_t received = read(fd, data, size);
+                if (received < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (received <= 0)
+                {
+                    return false;
+                }
+                data += received;
+                size -= received;
+            }
+            return true;
+        }
+    }
+
+    void MessageWriter::PutU8(uint8_t value)
+    {
+        data_.push_back(static_cast<char>(value));
+    }
+
+    void MessageWriter::PutU32(uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            data_.push_back(static_cast<char>(value >> shift & 0xff));
+        }
+    }
+
+    void MessageWriter::PutI32(int32_t value)
+    {
+        PutU32(static_cast<uint32_t>(value));
+    }
+
+    void MessageWriter::PutDouble(double value)
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            data_.push_back(static_cast<char>(bits >> shift & 0xff));
+        }
+    }
+
+    void MessageWriter::PutString(std::string_view value)
+    {
+        PutU32(static_cast<uint32_t>(value.size()));
+        data_.insert(data_.end(), value.begin(), value.end());
+    }
+
+    void MessageWriter::Append(const MessageWriter &other)
+    {
+        data_.insert(data_.end(), other.data_.begin(), other.data_.end());
+    }
+
+    const std::vector<char> &MessageWriter::GetData() const
+    {
+        return data_;
+    }
+
+    MessageReader::MessageReader(const std::vector<char> &data)
+        : data_(data)
+    {
+    }
+
+    uint8_t MessageReader::GetU8()
+    {
+        return static_cast<uint8_t>(GetLittleEndian(1));
+    }
+
+    uint32_t MessageReader::GetU32()
+    {
+        return static_cast<uint32_t>(GetLittleEndian(4));
+    }
+
+    int32_t MessageReader::GetI32()
+    {
+        return static_cast<int32_t>(GetU32());
+    }
+
+    double MessageReader::GetDouble()
+    {
+        const uint64_t bits = GetLittleEndian(8);
+        double value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::string MessageReader::GetString()
+    {
+        using std::string_literals::operator""s;
+
+        const uint32_t size = GetU32();
+        if (data_.size() - position_ < size)
+        {
+            throw std::runtime_error("Truncated shard message"s);
+        }
+        std::string result(data_.data() + position_, size);
+        position_ += size;
+        return result;
+    }
+
+    uint64_t MessageReader::GetLittleEndian(size_t size)
+    {
+        using std::string_literals::operator""s;
+
+        if (data_.size() - position_ < size)
+        {
+            throw std::runtime_error("Truncated shard message"s);
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            value |= uint64_t{static_cast<unsigned char>(data_[position_ + i])} << (8 * i);
+        }
+        position_ += size;
+        return value;
+    }
+
+    bool SendFrame(int fd, const std::vector<char> &body)
+    {
+        MessageWriter header;
+        header.PutU32(static_cast<uint32_t>(body.size()));
+        for (const std::vector<char> *part : {&header.GetData(), &body})
+        {
+            const char *data = part->data();
+            size_t size = part->size();
+            while (size > 0)
+            {
+                // MSG_NOSIGNAL: запись в закрытый шардом сокет — ошибка, а не SIGPIPE
+                const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (sent <= 0)
+                {
+                    return false;
+                }
+                data += sent;
+                size -= sent;
+            }
+        }
+        return true;
+    }
+
+    bool ReceiveFrame(int fd, std::vector<char> &body, Clock::time_point deadline)
+    {
+        std::vector<char> header(4);
+        if (!ReadExact(fd, header.data(), header.size(), deadline))
+        {
+            return false;
+        }
+        const uint32_t size = MessageReader(header).GetU32();
+        if (size > MAX_FRAME_SIZE)
+        {
+            return false;
+        }
+        body.resize(size);
+        return ReadExact(fd, body.data(), size, deadline);
+    }
+
+    int ListenUnixSocket(const std::string &socket_path)
+    {
+        using std::string_literals::operator""s;
+
+        const sockaddr_un address = MakeAddress(socket_path);
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot create socket: "s + std::strerror(errno));
+        }
+        unlink(socket_path.c_str());
+        if (bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 16) < 0)
+        {
+            const int error = errno;
+            close(fd);
+            throw std::runtime_error("Cannot listen on "s + socket_path + ": "s + std::strerror(error));
+        }
+        return fd;
+    }
+
+    int ConnectUnixSocket(const std::string &socket_path, std::chrono::milliseconds timeout)
+    {
+        const sockaddr_un address = MakeAddress(socket_path);
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        timeval send_timeout{};
+        send_timeout.tv_sec = timeout.count() / 1000;
+        send_timeout.tv_usec = timeout.count() % 1000 * 1000;
+        if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout)) < 0 ||
+            connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+}
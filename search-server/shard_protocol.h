@@ -0,0 +1,92 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Двоичный протокол между ShardCoordinator и процессами шардов (ServeShard) по Unix-сокетам.
+ * Кадр — длина тела (uint32) и тело. Тело запроса начинается с RequestType, тело ответа —
+ * с ResponseCode, за которым данные или текст ошибки. Числа — little-endian фиксированной
+ * ширины, строки — длина (uint32) и байты. На каждый запрос шард отвечает ровно одним кадром.
+ */
+namespace shard_protocol
+{
+    enum class RequestType : uint8_t
+    {
+        // id, текст, статус, рейтинги -> пусто
+        ADD_DOCUMENT = 1,
+        // id -> пусто
+        REMOVE_DOCUMENT,
+        // запрос -> число документов шарда, пары (слово, число документов со словом)
+        DOCUMENT_FREQS,
+        // запрос, статус, пары (слово, IDF) -> тройки (id, релевантность, рейтинг)
+        FIND_TOP,
+        // запрос, id -> статус, слова
+        MATCH_DOCUMENT,
+        // -> число документов
+        DOCUMENT_COUNT,
+        // -> пусто, после ответа шард завершается
+        SHUTDOWN,
+    };
+
+    enum class ResponseCode : uint8_t
+    {
+        OK = 0,
+        INVALID_ARGUMENT,
+        OUT_OF_RANGE,
+        INTERNAL_ERROR,
+    };
+
+    // Кадры длиннее считаются повреждёнными
+    inline constexpr uint32_t MAX_FRAME_SIZE = 64u << 20;
+
+    class MessageWriter
+    {
+    public:
+        void PutU8(uint8_t value);
+        void PutU32(uint32_t value);
+        void PutI32(int32_t value);
+        void PutDouble(double value);
+        void PutString(std::string_view value);
+        // Дописывает тело другого сообщения как есть
+        void Append(const MessageWriter &other);
+
+        const std::vector<char> &GetData() const;
+
+    private:
+        std::vector<char> data_;
+    };
+
+    // Чтение за концом сообщения бросает std::runtime_error
+    class MessageReader
+    {
+    public:
+        explicit MessageReader(const std::vector<char> &data);
+
+        uint8_t GetU8();
+        uint32_t GetU32();
+        int32_t GetI32();
+        double GetDouble();
+        std::string GetString();
+
+    private:
+        const std::vector<char> &data_;
+        size_t position_ = 0;
+
+        uint64_t GetLittleEndian(size_t size);
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // Возвращают false, если соединение закрыто, произошла ошибка или истёк deadline;
+    // после этого в потоке могут остаться части кадра, и соединение нужно закрыть
+    bool SendFrame(int fd, const std::vector<char> &body);
+    bool ReceiveFrame(int fd, std::vector<char> &body, Clock::time_point deadline = Clock::time_point::max());
+
+    // Слушающий сокет по пути socket_path (существующий файл заменяется); бросает std::runtime_error
+    int ListenUnixSocket(const std::string &socket_path);
+    // Соединение с шардом или -1; timeout ограничивает каждую запись в сокет
+    int ConnectUnixSocket(const std::string &socket_path, std::chrono::milliseconds timeout);
+}
@@ -0,0 +1,158 @@
+#include "shard_service.h"
+#include "shard_protocol.h"
+#include <cerrno>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace shard_protocol;
+
+namespace
+{
+    void WriteStatus(MessageWriter &response, DocumentStatus status)
+    {
+        response.PutU8(static_cast<uint8_t>(status));
+    }
+
+    DocumentStatus ReadStatus(MessageReader &request)
+    {
+        return static_cast<DocumentStatus>(request.GetU8());
+    }
+
+    // Выполняет запрос и пишет ответ без кода; false — запрос на завершение
+    bool HandleRequest(SearchServer &search_server, MessageReader &request, MessageWriter &response)
+    {
+        using std::string_literals::operator""s;
+
+        switch (static_cast<RequestType>(request.GetU8()))
+        {
+        case RequestType::ADD_DOCUMENT:
+        {
+            const int document_id = request.GetI32();
+            const std::string document = request.GetString();
+            const DocumentStatus status = ReadStatus(request);
+            std::vector<int> ratings(request.GetU32());
+            for (int &rating : ratings)
+            {
+                rating = request.GetI32();
+            }
+            search_server.AddDocument(document_id, document, status, ratings);
+            return true;
+        }
+        case RequestType::REMOVE_DOCUMENT:
+            search_server.RemoveDocument(request.GetI32());
+            return true;
+        case RequestType::DOCUMENT_FREQS:
+        {
+            const auto document_freqs = search_server.GetQueryDocumentFreqs(request.GetString());
+            response.PutU32(static_cast<uint32_t>(search_server.GetDocumentCount()));
+            response.PutU32(static_cast<uint32_t>(document_freqs.size()));
+            for (const auto &[word, document_freq] : document_freqs)
+            {
+                response.PutString(word);
+                response.PutU32(static_cast<uint32_t>(document_freq));
+            }
+            return true;
+        }
+        case RequestType::FIND_TOP:
+        {
+            const std::string raw_query = request.GetString();
+            const DocumentStatus status = ReadStatus(request);
+            InverseDocumentFreqs inverse_document_freqs;
+            for (uint32_t count = request.GetU32(); count > 0; --count)
+            {
+                std::string word = request.GetString();
+                inverse_document_freqs.emplace(std::move(word), request.GetDouble());
+            }
+            const auto documents = search_server.FindTopDocuments(std::execution::seq, raw_query, status, inverse_document_freqs);
+            response.PutU32(static_cast<uint32_t>(documents.size()));
+            for (const Document &document : documents)
+            {
+                response.PutI32(document.id);
+                response.PutDouble(document.relevance);
+                response.PutI32(document.rating);
+            }
+            return true;
+        }
+        case RequestType::MATCH_DOCUMENT:
+        {
+            const std::string raw_query = request.GetString();
+            const auto [words, status] = search_server.MatchDocument(raw_query, request.GetI32());
+            WriteStatus(response, status);
+            response.PutU32(static_cast<uint32_t>(words.size()));
+            for (const std::string_view word : words)
+            {
+                response.PutString(word);
+            }
+            return true;
+        }
+        case RequestType::DOCUMENT_COUNT:
+            response.PutU32(static_cast<uint32_t>(search_server.GetDocumentCount()));
+            return true;
+        case RequestType::SHUTDOWN:
+            return false;
+        }
+        throw std::invalid_argument("Unknown shard request"s);
+    }
+
+    // Обслуживает одно соединение; false — получен SHUTDOWN
+    bool ServeConnection(SearchServer &search_server, int fd)
+    {
+        std::vector<char> request_body;
+        while (ReceiveFrame(fd, request_body))
+        {
+            MessageReader request(request_body);
+            MessageWriter result;
+            MessageWriter response;
+            bool keep_serving = true;
+            try
+            {
+                keep_serving = HandleRequest(search_server, request, result);
+                response.PutU8(static_cast<uint8_t>(ResponseCode::OK));
+                response.Append(result);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                response.PutU8(static_cast<uint8_t>(ResponseCode::INVALID_ARGUMENT));
+                response.PutString(e.what());
+            }
+            catch (const std::out_of_range &e)
+            {
+                response.PutU8(static_cast<uint8_t>(ResponseCode::OUT_OF_RANGE));
+                response.PutString(e.what());
+            }
+            catch (const std::exception &e)
+            {
+                response.PutU8(static_cast<uint8_t>(ResponseCode::INTERNAL_ERROR));
+                response.PutString(e.what());
+            }
+            if (!SendFrame(fd, response.GetData()) || !keep_serving)
+            {
+                return keep_serving;
+            }
+        }
+        return true;
+    }
+}
+
+void ServeShard(SearchServer &search_server, const std::string &socket_path)
+{
+    const int listen_fd = ListenUnixSocket(socket_path);
+    bool keep_serving = true;
+    while (keep_serving)
+    {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        keep_serving = ServeConnection(search_server, fd);
+        close(fd);
+    }
+    close(listen_fd);
+    unlink(socket_path.c_str());
+}
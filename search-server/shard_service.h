@@ -0,0 +1,9 @@
+#pragma once
+#include "search_server.h"
+#include <string>
+
+// Обслуживает search_server как шард ShardCoordinator по Unix-сокету socket_path
+// (протокол — shard_protocol.h). Соединения принимаются по одному: координатор держит
+// одно постоянное соединение и после разрыва подключается заново. Возвращается после
+// запроса SHUTDOWN, файл сокета при этом удаляется
+void ServeShard(SearchServer &search_server, const std::string &socket_path);
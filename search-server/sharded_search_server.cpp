@@ -0,0 +1,123 @@
+#include "sharded_search_server.h"
+#include <cmath>
+
+ShardedSearchServer::ShardedSearchServer(const std::string &stop_words_text, size_t shard_count)
+    : ShardedSearchServer(std::string_view(stop_words_text), shard_count)
+{
+}
+
+ShardedSearchServer::ShardedSearchServer(const std::string_view stop_words_text, size_t shard_count)
+    : ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count)
+{
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int> &ratings)
+{
+    Shard &shard = GetShardOf(document_id);
+    // Индекс шарда растёт в потоке его арены: при первом касании память выделяется на её узле NUMA
+    shard.arena.execute([&]
+                        { shard.server.AddDocument(document_id, document, status, ratings); });
+    document_ids_.insert(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(const std::execution::sequenced_policy &, int document_id)
+{
+    Shard &shard = GetShardOf(document_id);
+    shard.arena.execute([&]
+                        { shard.server.RemoveDocument(std::execution::seq, document_id); });
+    document_ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(const std::execution::parallel_policy &, int document_id)
+{
+    Shard &shard = GetShardOf(document_id);
+    shard.arena.execute([&]
+                        { shard.server.RemoveDocument(std::execution::par, document_id); });
+    document_ids_.erase(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
+{
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::execution::sequenced_policy &, const std::string_view raw_query, int document_id) const
+{
+    return GetShardOf(document_id).server.MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::execution::parallel_policy &, const std::string_view raw_query, int document_id) const
+{
+    const Shard &shard = GetShardOf(document_id);
+    std::tuple<std::vector<std::string_view>, DocumentStatus> result;
+    shard.arena.execute([&]
+                        { result = shard.server.MatchDocument(std::execution::par, raw_query, document_id); });
+    return result;
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+    return static_cast<int>(document_ids_.size());
+}
+
+std::set<int>::const_iterator ShardedSearchServer::begin() const
+{
+    return document_ids_.begin();
+}
+
+std::set<int>::const_iterator ShardedSearchServer::end() const
+{
+    return document_ids_.end();
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+const SearchServer &ShardedSearchServer::GetShard(size_t shard) const
+{
+    return shards_.at(shard)->server;
+}
+
+ShardedSearchServer::Shard &ShardedSearchServer::GetShardOf(int document_id) const
+{
+    return *shards_[MixKey(static_cast<uint64_t>(document_id)) % shards_.size()];
+}
+
+InverseDocumentFreqs ShardedSearchServer::ComputeInverseDocumentFreqs(const std::string_view raw_query) const
+{
+    std::map<std::string, int, std::less<>> document_freqs;
+    for (const auto &shard : shards_)
+    {
+        for (auto &[word, document_freq] : shard->server.GetQueryDocumentFreqs(raw_query))
+        {
+            document_freqs[word] += document_freq;
+        }
+    }
+    InverseDocumentFreqs result;
+    const double document_count = static_cast<double>(document_ids_.size());
+    for (const auto &[word, document_freq] : document_freqs)
+    {
+        if (document_freq > 0)
+        {
+            result.emplace(word, std::log(document_count / document_freq));
+        }
+    }
+    return result;
+}
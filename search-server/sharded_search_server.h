@@ -0,0 +1,142 @@
+#pragma once
+#include "search_server.h"
+#include "concurrent_map.h"
+#include <tbb/task_arena.h>
+#include <tbb/info.h>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Поисковый сервер, разбитый на shard_count независимых SearchServer по хэшу id документа.
+ * Каждый шард работает в своей арене TBB, привязанной к узлу NUMA (по кругу, если шардов
+ * больше узлов), и документы шарда добавляются потоками этого узла: память индекса шарда
+ * выделяется рядом с ядрами, которые по нему ищут. Без сведений о топологии (TBB без tbbbind)
+ * арены не привязаны.
+ *
+ * Запрос рассылается всем шардам в два шага: сначала собираются числа документов со словами
+ * запроса, из их сумм считаются общие IDF, затем каждый шард ищет с этими IDF, и лучшие
+ * документы шардов сливаются. Релевантность та же, что у одного SearchServer со всеми документами.
+ */
+class ShardedSearchServer
+{
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer &stop_words, size_t shard_count);
+    ShardedSearchServer(const std::string &stop_words_text, size_t shard_count);
+    ShardedSearchServer(const std::string_view stop_words_text, size_t shard_count);
+
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+    void RemoveDocument(int document_id);
+    void RemoveDocument(const std::execution::sequenced_policy &, int document_id);
+    void RemoveDocument(const std::execution::parallel_policy &, int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentStatus status) const;
+    // Шарды опрашиваются параллельно при любой политике; policy задаёт поиск внутри шарда
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy &, const std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy &, const std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    std::set<int>::const_iterator begin() const;
+    std::set<int>::const_iterator end() const;
+
+    size_t GetShardCount() const;
+    const SearchServer &GetShard(size_t shard) const;
+
+private:
+    struct Shard
+    {
+        template <typename StopWords>
+        Shard(const tbb::task_arena::constraints &constraints, const StopWords &stop_words)
+            : arena(constraints), server(stop_words)
+        {
+        }
+
+        mutable tbb::task_arena arena;
+        SearchServer server;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::set<int> document_ids_;
+
+    Shard &GetShardOf(int document_id) const;
+    // Общие IDF плюс-слов запроса по числам документов во всех шардах
+    InverseDocumentFreqs ComputeInverseDocumentFreqs(const std::string_view raw_query) const;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer &stop_words, size_t shard_count)
+{
+    using std::string_literals::operator""s;
+
+    if (shard_count == 0)
+    {
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+    const std::vector<tbb::numa_node_id> numa_nodes = tbb::info::numa_nodes();
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        shards_.push_back(std::make_unique<Shard>(tbb::task_arena::constraints(numa_nodes[i % numa_nodes.size()]), stop_words));
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query) const
+{
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentStatus status) const
+{
+    return FindTopDocuments<ExecutionPolicy, DocumentStatus>(policy, raw_query, status);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy &&policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
+{
+    // Некорректный запрос отвергается здесь, до параллельной рассылки
+    const InverseDocumentFreqs inverse_document_freqs = ComputeInverseDocumentFreqs(raw_query);
+
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    std::for_each(std::execution::par,
+                  shard_results.begin(), shard_results.end(),
+                  [this, &policy, raw_query, &document_predicate, &inverse_document_freqs, &shard_results](std::vector<Document> &result)
+                  {
+                      const Shard &shard = *shards_[&result - shard_results.data()];
+                      shard.arena.execute([&]
+                                          { result = shard.server.FindTopDocuments(policy, raw_query, document_predicate, inverse_document_freqs); });
+                  });
+
+    std::vector<Document> matched_documents;
+    for (const std::vector<Document> &result : shard_results)
+    {
+        matched_documents.insert(matched_documents.end(), result.begin(), result.end());
+    }
+    std::sort(matched_documents.begin(), matched_documents.end(), IsRankedBefore);
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return matched_documents;
+}
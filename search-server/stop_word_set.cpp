@@ -0,0 +1,45 @@
+#include "stop_word_set.h"
+#include <algorithm>
+#include <functional>
+
+void StopWordSet::Build()
+{
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+    words_.erase(std::remove(words_.begin(), words_.end(), std::string()), words_.end());
+
+    size_t capacity = 8;
+    while (capacity < words_.size() * 2)
+    {
+        capacity <<= 1;
+    }
+    slots_.assign(capacity, EMPTY_SLOT);
+    const std::hash<std::string_view> hasher;
+    for (size_t i = 0; i < words_.size(); ++i)
+    {
+        const std::string &word = words_[i];
+        length_mask_ |= uint64_t{1} << std::min<size_t>(word.size(), 63);
+        const auto first = static_cast<unsigned char>(word[0]);
+        first_bytes_[first >> 6] |= uint64_t{1} << (first & 63);
+
+        size_t index = hasher(word) & (capacity - 1);
+        while (slots_[index] != EMPTY_SLOT)
+        {
+            index = (index + 1) & (capacity - 1);
+        }
+        slots_[index] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+uint32_t StopWordSet::FindSlot(std::string_view word) const
+{
+    const size_t mask = slots_.size() - 1;
+    for (size_t index = std::hash<std::string_view>{}(word)&mask; slots_[index] != EMPTY_SLOT; index = (index + 1) & mask)
+    {
+        if (words_[slots_[index] - 1] == word)
+        {
+            return slots_[index];
+        }
+    }
+    return EMPTY_SLOT;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Компактное множество стоп-слов, собираемое один раз при создании сервера.
+ * Большинство обычных слов отсекается без хэширования: по маске встречающихся
+ * длин и битовой карте первых байтов. Остальные проверяются в хэш-таблице
+ * с открытой адресацией.
+ */
+class StopWordSet
+{
+public:
+    StopWordSet() = default;
+
+    template <typename StringContainer>
+    explicit StopWordSet(const StringContainer &words)
+    {
+        for (const std::string_view word : words)
+        {
+            words_.emplace_back(word);
+        }
+        Build();
+    }
+
+    bool Contains(std::string_view word) const
+    {
+        const size_t length_bit = word.size() < 63 ? word.size() : 63;
+        if (word.empty() || !(length_mask_ >> length_bit & 1))
+        {
+            return false;
+        }
+        const auto first = static_cast<unsigned char>(word[0]);
+        if (!(first_bytes_[first >> 6] >> (first & 63) & 1))
+        {
+            return false;
+        }
+        return FindSlot(word) != EMPTY_SLOT;
+    }
+
+    size_t size() const
+    {
+        return words_.size();
+    }
+
+private:
+    static constexpr uint32_t EMPTY_SLOT = 0;
+
+    std::vector<std::string> words_;
+    // Индекс слова + 1, 0 — пустой слот
+    std::vector<uint32_t> slots_;
+    uint64_t length_mask_ = 0;
+    uint64_t first_bytes_[4] = {0, 0, 0, 0};
+
+    void Build();
+    uint32_t FindSlot(std::string_view word) const;
+};
@@ -1,23 +1,141 @@
 #include "string_processing.h"
+#include <cstdint>
 
-std::vector<std::string_view> SplitIntoWords(std::string_view str)
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace
 {
-    std::vector<std::string_view> result;
-    while (true)
+    inline bool IsSpace(unsigned char c)
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    // Маска байтов <= ' ' (пробельные и управляющие) в блоке, начинающемся с data.
+    // Всё остальное — символы слова, их можно пропускать блоком целиком
+#if defined(__AVX2__)
+    constexpr size_t BLOCK_SIZE = 32;
+
+    inline uint32_t SpecialMask(const char *data)
+    {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+        const __m256i is_special = _mm256_cmpeq_epi8(_mm256_min_epu8(block, _mm256_set1_epi8(' ')), block);
+        return static_cast<uint32_t>(_mm256_movemask_epi8(is_special));
+    }
+#elif defined(__SSE2__)
+    constexpr size_t BLOCK_SIZE = 16;
+
+    inline uint32_t SpecialMask(const char *data)
     {
-        uint64_t space = str.find(' ');
-        if (str[0] != ' ')
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        const __m128i is_special = _mm_cmpeq_epi8(_mm_min_epu8(block, _mm_set1_epi8(' ')), block);
+        return static_cast<uint32_t>(_mm_movemask_epi8(is_special));
+    }
+#else
+    constexpr size_t BLOCK_SIZE = 8;
+
+    inline uint32_t SpecialMask(const char *data)
+    {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < BLOCK_SIZE; ++i)
         {
-            result.push_back(str.substr(0, space));
+            mask |= static_cast<uint32_t>(static_cast<unsigned char>(data[i]) <= ' ') << i;
         }
-        if (space == str.npos)
+        return mask;
+    }
+#endif
+
+    class Tokenizer
+    {
+    public:
+        Tokenizer(std::string_view str, std::vector<std::string_view> &words)
+            : str_(str), words_(words)
         {
-            break;
+            words_.clear();
         }
-        else
+
+        // Вызывается для каждого байта <= ' ' по возрастанию позиции
+        void OnSpecial(size_t pos)
         {
-            str.remove_prefix(space + 1);
+            if (word_start_ == std::string_view::npos && pos > scanned_)
+            {
+                word_start_ = scanned_;
+            }
+            if (IsSpace(static_cast<unsigned char>(str_[pos])))
+            {
+                FinishWord(pos);
+            }
+            else
+            {
+                if (word_start_ == std::string_view::npos)
+                {
+                    word_start_ = pos;
+                }
+                word_is_invalid_ = true;
+            }
+            scanned_ = pos + 1;
+        }
+
+        size_t Finish()
+        {
+            if (word_start_ == std::string_view::npos && str_.size() > scanned_)
+            {
+                word_start_ = scanned_;
+            }
+            FinishWord(str_.size());
+            return first_invalid_ == std::string_view::npos ? words_.size() : first_invalid_;
+        }
+
+    private:
+        std::string_view str_;
+        std::vector<std::string_view> &words_;
+        size_t scanned_ = 0;
+        size_t word_start_ = std::string_view::npos;
+        bool word_is_invalid_ = false;
+        size_t first_invalid_ = std::string_view::npos;
+
+        void FinishWord(size_t end)
+        {
+            if (word_start_ == std::string_view::npos)
+            {
+                return;
+            }
+            if (word_is_invalid_ && first_invalid_ == std::string_view::npos)
+            {
+                first_invalid_ = words_.size();
+            }
+            words_.push_back(str_.substr(word_start_, end - word_start_));
+            word_start_ = std::string_view::npos;
+            word_is_invalid_ = false;
+        }
+    };
+}
+
+size_t SplitIntoWords(std::string_view str, std::vector<std::string_view> &words)
+{
+    Tokenizer tokenizer(str, words);
+    size_t pos = 0;
+    for (; pos + BLOCK_SIZE <= str.size(); pos += BLOCK_SIZE)
+    {
+        for (uint32_t mask = SpecialMask(str.data() + pos); mask != 0; mask &= mask - 1)
+        {
+            tokenizer.OnSpecial(pos + __builtin_ctz(mask));
+        }
+    }
+    for (; pos < str.size(); ++pos)
+    {
+        if (static_cast<unsigned char>(str[pos]) <= ' ')
+        {
+            tokenizer.OnSpecial(pos);
         }
     }
+    return tokenizer.Finish();
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view str)
+{
+    std::vector<std::string_view> result;
+    SplitIntoWords(str, result);
     return result;
-}
\ No newline at end of file
+}
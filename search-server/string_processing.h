@@ -1,10 +1,17 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
 #include <set>
 
+// Разбивает строку на слова по пробельным символам ASCII (' ', \t, \n, \v, \f, \r)
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 
+// То же за один проход с проверкой на управляющие символы: слова пишутся в переиспользуемый
+// буфер words (предыдущее содержимое стирается). Возвращает индекс первого слова, содержащего
+// управляющий символ, или words.size(), если таких нет
+size_t SplitIntoWords(std::string_view str, std::vector<std::string_view> &words);
+
 template <typename StringContainer>
 inline std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer &strings)
 {
@@ -0,0 +1,191 @@
+#include "test_example_functions.h"
+#include "search_server.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
+
+std::string GenerateWord(std::mt19937 &generator, int max_length)
+{
+    const int length = std::uniform_int_distribution(1, max_length)(generator);
+    std::string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i)
+    {
+        word.push_back(std::uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+std::vector<std::string> GenerateDictionary(std::mt19937 &generator, int word_count, int max_length)
+{
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i)
+    {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+std::string GenerateQuery(std::mt19937 &generator, const std::vector<std::string> &dictionary, int word_count, double minus_prob)
+{
+    std::string query;
+    for (int i = 0; i < word_count; ++i)
+    {
+        if (!query.empty())
+        {
+            query.push_back(' ');
+        }
+        if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob)
+        {
+            query.push_back('-');
+        }
+        query += dictionary[std::uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+std::vector<std::string> GenerateQueries(std::mt19937 &generator, const std::vector<std::string> &dictionary, int query_count, int max_word_count, double minus_prob)
+{
+    std::vector<std::string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i)
+    {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count, minus_prob));
+    }
+    return queries;
+}
+
+namespace
+{
+    struct StoredDocument
+    {
+        std::string text;
+        DocumentStatus status;
+        std::vector<int> ratings;
+    };
+
+    const std::string REMOVAL_STOP_WORDS = "and with";
+
+    SearchServer BuildServer(const std::map<int, StoredDocument> &documents)
+    {
+        SearchServer server(REMOVAL_STOP_WORDS);
+        for (const auto &[document_id, document] : documents)
+        {
+            server.AddDocument(document_id, document.text, document.status, document.ratings);
+        }
+        return server;
+    }
+
+    void AssertSameResults(const SearchServer &mutated, const SearchServer &rebuilt, const std::vector<std::string> &queries)
+    {
+        assert(mutated.GetDocumentCount() == rebuilt.GetDocumentCount());
+        assert(std::equal(mutated.begin(), mutated.end(), rebuilt.begin(), rebuilt.end()));
+        const auto any_status = [](int, DocumentStatus, int)
+        { return true; };
+        for (const std::string &query : queries)
+        {
+            const auto expected = rebuilt.FindTopDocuments(query, any_status);
+            for (const auto &found : {mutated.FindTopDocuments(query, any_status),
+                                      mutated.FindTopDocuments(std::execution::par, query, any_status)})
+            {
+                assert(found.size() == expected.size());
+                for (size_t i = 0; i < found.size(); ++i)
+                {
+                    assert(found[i].id == expected[i].id);
+                    assert(found[i].rating == expected[i].rating);
+                    assert(std::abs(found[i].relevance - expected[i].relevance) < EPSILON);
+                }
+            }
+            for (const int document_id : rebuilt)
+            {
+                const auto [expected_words, expected_status] = rebuilt.MatchDocument(query, document_id);
+                const auto [words, status] = mutated.MatchDocument(query, document_id);
+                assert(words == expected_words);
+                assert(status == expected_status);
+                const auto [par_words, par_status] = mutated.MatchDocument(std::execution::par, query, document_id);
+                assert(par_words == expected_words);
+                assert(par_status == expected_status);
+            }
+        }
+    }
+}
+
+void TestRemovalMatchesRebuild()
+{
+    std::mt19937 generator(42);
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto queries = GenerateQueries(generator, dictionary, 30, 4, 0.2);
+    const auto random_int = [&generator](int min, int max)
+    { return std::uniform_int_distribution(min, max)(generator); };
+    const int max_id = 400;
+    const auto make_document = [&]
+    {
+        return StoredDocument{GenerateQuery(generator, dictionary, random_int(1, 12)),
+                              static_cast<DocumentStatus>(random_int(0, 3)),
+                              {random_int(-10, 10), random_int(-10, 10)}};
+    };
+
+    std::map<int, StoredDocument> documents;
+    for (int document_id = 0; document_id < max_id; document_id += random_int(1, 2))
+    {
+        documents.emplace(document_id, make_document());
+    }
+    SearchServer server = BuildServer(documents);
+
+    for (int round = 0; round < 40; ++round)
+    {
+        // Id берутся из всего диапазона, поэтому часть из них уже удалена или не добавлялась
+        std::vector<int> document_ids(random_int(1, 25));
+        for (int &document_id : document_ids)
+        {
+            document_id = random_int(0, max_id);
+        }
+        document_ids.push_back(document_ids.front());
+        switch (round % 4)
+        {
+        case 0:
+            for (const int document_id : document_ids)
+            {
+                server.RemoveDocument(document_id);
+            }
+            break;
+        case 1:
+            for (const int document_id : document_ids)
+            {
+                server.RemoveDocument(std::execution::par, document_id);
+            }
+            break;
+        case 2:
+            server.RemoveDocuments(std::execution::seq, document_ids);
+            break;
+        default:
+            server.RemoveDocuments(std::execution::par, document_ids);
+            break;
+        }
+        for (const int document_id : document_ids)
+        {
+            documents.erase(document_id);
+        }
+
+        // Повторные добавления занимают освобождённые слоты и id слов
+        for (int added = random_int(0, 20); added > 0; --added)
+        {
+            const int document_id = random_int(0, max_id);
+            if (documents.count(document_id) == 0)
+            {
+                StoredDocument document = make_document();
+                server.AddDocument(document_id, document.text, document.status, document.ratings);
+                documents.emplace(document_id, std::move(document));
+            }
+        }
+
+        if (round % 5 == 4)
+        {
+            AssertSameResults(server, BuildServer(documents), queries);
+        }
+    }
+    AssertSameResults(server, BuildServer(documents), queries);
+}
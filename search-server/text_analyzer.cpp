@@ -0,0 +1,252 @@
+#include "text_analyzer.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    inline bool IsContinuation(unsigned char c)
+    {
+        return (c & 0xC0) == 0x80;
+    }
+
+    inline size_t GetSequenceLength(unsigned char lead)
+    {
+        if (lead >= 0xC2 && lead < 0xE0)
+        {
+            return 2;
+        }
+        if (lead >= 0xE0 && lead < 0xF0)
+        {
+            return 3;
+        }
+        if (lead >= 0xF0 && lead < 0xF5)
+        {
+            return 4;
+        }
+        return 1;
+    }
+}
+
+TextAnalyzer::TextAnalyzer()
+    : TextAnalyzer(Options{})
+{
+}
+
+TextAnalyzer::TextAnalyzer(Options options)
+    : options_(options)
+{
+    for (int c = 0; c < 256; ++c)
+    {
+        if (c >= 0x80)
+        {
+            byte_class_[c] = ByteClass::MULTIBYTE;
+        }
+        else if (c == ' ' || (c >= '\t' && c <= '\r'))
+        {
+            byte_class_[c] = ByteClass::SPACE;
+        }
+        else if (c < ' ')
+        {
+            byte_class_[c] = ByteClass::CONTROL;
+        }
+        else if (options_.strip_punctuation && (c < '0' || (c > '9' && c < 'A') || (c > 'Z' && c < 'a') || (c > 'z' && c < 0x7F)))
+        {
+            byte_class_[c] = ByteClass::PUNCTUATION;
+        }
+        else
+        {
+            byte_class_[c] = ByteClass::WORD;
+        }
+    }
+    for (int c = 0; c < 128; ++c)
+    {
+        ascii_fold_[c] = static_cast<char>(options_.fold_case && c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+    }
+}
+
+const TextAnalyzer::Options &TextAnalyzer::GetOptions() const
+{
+    return options_;
+}
+
+size_t TextAnalyzer::NormalizeChar(std::string_view text, size_t pos, char *out, size_t &written, ByteClass &kind) const
+{
+    const unsigned char c = text[pos];
+    kind = byte_class_[c];
+    if (kind != ByteClass::MULTIBYTE)
+    {
+        if (kind != ByteClass::SPACE && kind != ByteClass::PUNCTUATION)
+        {
+            out[written++] = ascii_fold_[c];
+        }
+        return 1;
+    }
+
+    kind = ByteClass::WORD;
+    const size_t length = GetSequenceLength(c);
+    bool valid = length > 1 && pos + length <= text.size();
+    for (size_t i = 1; valid && i < length; ++i)
+    {
+        valid = IsContinuation(text[pos + i]);
+    }
+    if (!valid)
+    {
+        out[written++] = text[pos];
+        return 1;
+    }
+
+    const unsigned char c2 = text[pos + 1];
+    unsigned char lead = c;
+    unsigned char tail = c2;
+    if (length == 2)
+    {
+        if (c == 0xC2 && c2 == 0xA0)
+        {
+            // Неразрывный пробел
+            kind = ByteClass::SPACE;
+            return length;
+        }
+        if (options_.strip_punctuation && c == 0xC2 && (c2 == 0xA1 || c2 == 0xA7 || c2 == 0xAB || c2 == 0xB6 || c2 == 0xB7 || c2 == 0xBB || c2 == 0xBF))
+        {
+            // ¡ § « ¶ · » ¿
+            kind = ByteClass::PUNCTUATION;
+            return length;
+        }
+        if (options_.fold_case)
+        {
+            if (c == 0xC3 && c2 >= 0x80 && c2 <= 0x9E && c2 != 0x97)
+            {
+                // Latin-1: U+00C0..U+00DE -> U+00E0..U+00FE (кроме знака умножения)
+                tail = c2 + 0x20;
+            }
+            else if (c == 0xD0 && c2 >= 0x80 && c2 <= 0x8F)
+            {
+                // Ѐ..Џ (в том числе Ё) -> ѐ..џ
+                lead = 0xD1;
+                tail = c2 + 0x10;
+            }
+            else if (c == 0xD0 && c2 >= 0x90 && c2 <= 0x9F)
+            {
+                // А..П -> а..п
+                tail = c2 + 0x20;
+            }
+            else if (c == 0xD0 && c2 >= 0xA0 && c2 <= 0xAF)
+            {
+                // Р..Я -> р..я
+                lead = 0xD1;
+                tail = c2 - 0x20;
+            }
+        }
+        out[written++] = static_cast<char>(lead);
+        out[written++] = static_cast<char>(tail);
+        return length;
+    }
+
+    if (length == 3 && c == 0xE2)
+    {
+        const unsigned char c3 = text[pos + 2];
+        if ((c2 == 0x80 && (c3 <= 0x8A || c3 == 0xAF)) || (c2 == 0x81 && c3 == 0x9F))
+        {
+            // U+2000..U+200A, U+202F, U+205F: типографские пробелы
+            kind = ByteClass::SPACE;
+            return length;
+        }
+        if (options_.strip_punctuation && ((c2 == 0x80 && c3 >= 0x90) || (c2 == 0x81 && c3 <= 0x9E)))
+        {
+            // U+2010..U+205E: тире, кавычки, многоточие и прочая пунктуация
+            kind = ByteClass::PUNCTUATION;
+            return length;
+        }
+    }
+    for (size_t i = 0; i < length; ++i)
+    {
+        out[written++] = text[pos + i];
+    }
+    return length;
+}
+
+size_t TextAnalyzer::Analyze(std::string_view text, std::string &out, std::vector<std::string_view> &words) const
+{
+    out.resize(text.size());
+    size_t written = 0;
+    const size_t result = Analyze(text, out.data(), written, words);
+    // Уменьшение размера не перевыделяет память, words остаются валидными
+    out.resize(written);
+    return result;
+}
+
+size_t TextAnalyzer::Analyze(std::string_view text, char *data, size_t &written, std::vector<std::string_view> &words) const
+{
+    words.clear();
+    written = 0;
+    size_t word_start = std::string_view::npos;
+    bool word_is_invalid = false;
+    size_t first_invalid = std::string_view::npos;
+
+    const auto finish_word = [&]
+    {
+        if (word_start == std::string_view::npos)
+        {
+            return;
+        }
+        if (written > word_start)
+        {
+            if (word_is_invalid && first_invalid == std::string_view::npos)
+            {
+                first_invalid = words.size();
+            }
+            words.emplace_back(data + word_start, written - word_start);
+        }
+        word_start = std::string_view::npos;
+        word_is_invalid = false;
+    };
+
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+#if defined(__SSE2__)
+        if (!options_.strip_punctuation && pos + 16 <= text.size())
+        {
+            // Блок из 16 печатных ASCII-символов: только перевод в нижний регистр
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + pos));
+            if (_mm_movemask_epi8(_mm_cmpgt_epi8(block, _mm_set1_epi8(' '))) == 0xFFFF)
+            {
+                __m128i folded = block;
+                if (options_.fold_case)
+                {
+                    const __m128i is_upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)));
+                    folded = _mm_add_epi8(block, _mm_and_si128(is_upper, _mm_set1_epi8('a' - 'A')));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(data + written), folded);
+                if (word_start == std::string_view::npos)
+                {
+                    word_start = written;
+                }
+                written += 16;
+                pos += 16;
+                continue;
+            }
+        }
+#endif
+        ByteClass kind;
+        const size_t from = written;
+        pos += NormalizeChar(text, pos, data, written, kind);
+        if (kind == ByteClass::SPACE)
+        {
+            finish_word();
+            continue;
+        }
+        if (word_start == std::string_view::npos)
+        {
+            word_start = from;
+        }
+        if (kind == ByteClass::CONTROL)
+        {
+            word_is_invalid = true;
+        }
+    }
+    finish_word();
+    return first_invalid == std::string_view::npos ? words.size() : first_invalid;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Нормализация текста для индексации и поиска: декодирует UTF-8, приводит к нижнему
+ * регистру латиницу (ASCII и Latin-1) и кириллицу, при необходимости выбрасывает
+ * знаки препинания. Разбиение на слова выполняется в том же проходе.
+ * Все преобразования не удлиняют текст, поэтому результат пишется в буфер
+ * размера исходного текста без перевыделений. Некорректные последовательности
+ * UTF-8 копируются как есть.
+ */
+class TextAnalyzer
+{
+public:
+    struct Options
+    {
+        bool fold_case = true;
+        bool strip_punctuation = false;
+    };
+
+    TextAnalyzer();
+    explicit TextAnalyzer(Options options);
+
+    // Нормализует text в out и разбивает его на слова (words указывают внутрь out,
+    // out нельзя изменять, пока они используются). Возвращает индекс первого слова
+    // с управляющим символом или words.size(), если таких нет
+    size_t Analyze(std::string_view text, std::string &out, std::vector<std::string_view> &words) const;
+
+    // То же для внешнего буфера: out должен вмещать text.size() байт,
+    // в written возвращается длина нормализованного текста
+    size_t Analyze(std::string_view text, char *out, size_t &written, std::vector<std::string_view> &words) const;
+
+    const Options &GetOptions() const;
+
+private:
+    enum class ByteClass : uint8_t
+    {
+        WORD,
+        SPACE,
+        CONTROL,
+        PUNCTUATION,
+        MULTIBYTE,
+    };
+
+    Options options_;
+    std::array<ByteClass, 256> byte_class_;
+    std::array<char, 128> ascii_fold_;
+
+    // Обрабатывает символ, начинающийся в text[pos]: дописывает нормализованные байты
+    // в out[written], возвращает число прочитанных байтов и класс символа в kind
+    size_t NormalizeChar(std::string_view text, size_t pos, char *out, size_t &written, ByteClass &kind) const;
+};